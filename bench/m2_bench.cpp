@@ -0,0 +1,448 @@
+/*
+   Copyright (c) 2007 The Regents of the University of California.
+   All rights reserved.
+
+   Permission is hereby granted, without written agreement and without
+   license or royalty fees, to use, copy, modify, and distribute this
+   software and its documentation for any purpose, provided that the
+   above copyright notice and the following two paragraphs appear in all
+   copies of this software and that appropriate acknowledgments are made
+   to the research of the Metropolis group.
+
+   IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO ANY PARTY
+   FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES
+   ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF
+   THE UNIVERSITY OF CALIFORNIA HAS BEEN ADVISED OF THE POSSIBILITY OF
+   SUCH DAMAGE.
+
+   THE UNIVERSITY OF CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE SOFTWARE
+   PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND THE UNIVERSITY OF
+   CALIFORNIA HAS NO OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES,
+   ENHANCEMENTS, OR MODIFICATIONS.
+
+   METROPOLIS_COPYRIGHT_VERSION_1
+   COPYRIGHTENDKEY
+   */
+
+// MetroII synthetic benchmark: N reader/writer pairs communicating through
+// blocking channels, a fraction of them mapped onto reader/writer tasks that
+// run on M processors.
+//
+// usage: m2_bench [-pairs N] [-procs M] [-iters K] [-density D] [-fanin F]
+//                 [-sched rr|lt|both]
+//
+//   -pairs    number of reader/writer pairs (default 16)
+//   -procs    number of processors the tasks are spread over (default 4)
+//   -iters    items written by every writer (default 100)
+//   -density  fraction of the pairs that are mapped, 0 to 1 (default 1)
+//   -fanin    number of functional processes joined in each rendezvous with
+//             one task (default 1, pairwise mapping constraints)
+//   -sched    schedulers of the processors: round robin, logical time or
+//             both (default both)
+
+#include "metroII.h"
+#include <sys/resource.h>
+
+//******************************************************************************
+// Interfaces
+//******************************************************************************
+
+// functional services
+M2_INTERFACE(i_receiver)
+{
+  public:
+    M2_PROCEDURE(receive, double *, unsigned long);
+    M2_PROCEDURE(wait_data);
+    M2_PROCEDURE(read_notify);
+};
+
+M2_INTERFACE(i_sender)
+{
+  public:
+    M2_PROCEDURE(send, const double *, unsigned long);
+    M2_PROCEDURE(wait_empty);
+    M2_PROCEDURE(write_notify);
+};
+
+// architectural services
+M2_INTERFACE(i_arch_receiver)
+{
+  public:
+    M2_PROCEDURE(receive, double *, unsigned long);
+};
+
+M2_INTERFACE(i_arch_sender)
+{
+  public:
+    M2_PROCEDURE(send, const double *, unsigned long);
+};
+
+//******************************************************************************
+// Functional components
+//******************************************************************************
+M2_COMPONENT(Reader)
+{
+  public:
+    m2_required_port<i_receiver> out_port;
+    m2_event *receive_event_beg, *receive_event_end;
+    int iterations;
+
+    SC_HAS_PROCESS(Reader);
+
+    Reader(sc_module_name n, int _iterations) : m2_component(n)
+    {
+        iterations = _iterations;
+        SC_THREAD(main);
+        receive_event_beg = &(out_port->receive(M2_EVENT_BEGIN));
+        receive_event_end = &(out_port->receive(M2_EVENT_END));
+    }
+
+    void main()
+    {
+        sc_process_handle this_thread = sc_get_current_process_handle();
+        double array[3];
+
+        for (int i = 0; i < iterations; i++)
+        {
+            out_port->wait_data();
+            out_port->receive(array, 3);
+            out_port->read_notify();
+        }
+        m2_end(this_thread);
+    }
+};
+
+M2_COMPONENT(Writer)
+{
+  public:
+    m2_required_port<i_sender> out_port;
+    m2_event *send_event_beg, *send_event_end;
+    int iterations;
+
+    SC_HAS_PROCESS(Writer);
+
+    Writer(sc_module_name n, int _iterations) : m2_component(n)
+    {
+        iterations = _iterations;
+        SC_THREAD(main);
+        send_event_beg = &(out_port->send(M2_EVENT_BEGIN));
+        send_event_end = &(out_port->send(M2_EVENT_END));
+    }
+
+    void main()
+    {
+        sc_process_handle this_thread = sc_get_current_process_handle();
+        double array[3];
+
+        for (int i = 0; i < iterations; i++)
+        {
+            array[0] = i;
+            array[1] = 3 * i;
+            array[2] = 5 * i;
+            out_port->wait_empty();
+            out_port->send(array, 3);
+            out_port->write_notify();
+        }
+        m2_end(this_thread);
+    }
+};
+
+class blocking_channel : public m2_channel, public i_sender, public i_receiver
+{
+  public:
+    m2_read_port<i_receiver> read_port;
+    m2_write_port<i_sender> write_port;
+
+    blocking_channel(sc_module_name n) : m2_channel(n)
+    {
+        empty = true;
+    }
+
+    void wait_data()
+    {
+        if (empty) {
+            m2_wait(written);
+        }
+    }
+
+    void wait_empty()
+    {
+        if (!empty) {
+            m2_wait(read);
+        }
+    }
+
+    void write_notify()
+    {
+        written.notify();
+    }
+
+    void read_notify()
+    {
+        read.notify();
+    }
+
+    void receive(double * data, unsigned long len)
+    {
+        memcpy(data, buffer, len * sizeof(double));
+        empty = true;
+    }
+
+    void send(const double * data, unsigned long len)
+    {
+        memcpy(buffer, data, len * sizeof(double));
+        empty = false;
+    }
+
+  private:
+    bool empty;
+    sc_event written, read;
+    double buffer[3];
+};
+
+//******************************************************************************
+// Architecture components
+//******************************************************************************
+M2_COMPONENT(Reader_Task)
+{
+  public:
+    m2_required_port<i_arch_receiver> read_port;
+    m2_event *receive_event_beg, *receive_event_end;
+
+    SC_HAS_PROCESS(Reader_Task);
+
+    Reader_Task(sc_module_name n) : m2_component(n)
+    {
+        SC_THREAD(receive_thread);
+        receive_event_beg = &(read_port->receive(M2_EVENT_BEGIN));
+        receive_event_end = &(read_port->receive(M2_EVENT_END));
+    }
+
+    void receive_thread()
+    {
+        double array[3];
+        while (true)
+        {
+            read_port->receive(array, 3);
+        }
+    }
+};
+
+M2_COMPONENT(Writer_Task)
+{
+  public:
+    m2_required_port<i_arch_sender> write_port;
+    m2_event *send_event_beg, *send_event_end;
+
+    SC_HAS_PROCESS(Writer_Task);
+
+    Writer_Task(sc_module_name n) : m2_component(n)
+    {
+        SC_THREAD(send_thread);
+        send_event_beg = &(write_port->send(M2_EVENT_BEGIN));
+        send_event_end = &(write_port->send(M2_EVENT_END));
+    }
+
+    void send_thread()
+    {
+        double array[3] = {0, 0, 0};
+        while (true)
+        {
+            write_port->send(array, 3);
+        }
+    }
+};
+
+class Processor : public m2_component, public i_arch_receiver, public i_arch_sender
+{
+  public:
+    m2_provided_port<i_arch_receiver> read_port;
+    m2_provided_port<i_arch_sender> write_port;
+
+    Processor(sc_module_name n) : m2_component(n)
+    {
+    }
+
+    void receive(double * data, unsigned long size)
+    {
+    }
+
+    void send(const double * data, unsigned long size)
+    {
+    }
+};
+
+//******************************************************************************
+// sc_main
+// build the system from the command line parameters and report the rates
+//******************************************************************************
+static const char* bench_name(const char* prefix, int i)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%s%d", prefix, i);
+    return name_arena.intern(buf);
+}
+
+int sc_main (int argc, char** argv)
+{
+    int pairs = 16;
+    int procs = 4;
+    int iterations = 100;
+    double density = 1;
+    int fanin = 1;
+    bool use_rr = true;
+    bool use_lt = true;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "-pairs") == 0)
+            pairs = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-procs") == 0)
+            procs = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-iters") == 0)
+            iterations = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-density") == 0)
+            density = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "-fanin") == 0)
+            fanin = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-sched") == 0)
+        {
+            use_rr = (strcmp(argv[i + 1], "lt") != 0);
+            use_lt = (strcmp(argv[i + 1], "rr") != 0);
+        }
+        else {
+            cerr << "unknown option " << argv[i] << endl;
+            return 1;
+        }
+    }
+
+    int mapped = (int)(pairs * density + 0.5);
+    fanin = std::max(fanin, 1);
+    int tasks = (mapped + fanin - 1) / fanin;  // writer tasks, same number of reader tasks
+    procs = std::max(1, std::min(procs, tasks));
+
+    cout << "pairs " << pairs << ", mapped " << mapped << ", tasks " << 2 * tasks
+        << ", processors " << (tasks > 0 ? procs : 0) << ", fan-in " << fanin
+        << ", iterations " << iterations << endl;
+
+    // functional model
+    std::vector<Reader *> readers;
+    std::vector<Writer *> writers;
+    for (int i = 0; i < pairs; i++)
+    {
+        blocking_channel* c = new blocking_channel(bench_name("Channel", i));
+        Reader* r = new Reader(bench_name("Reader", i), iterations);
+        Writer* w = new Writer(bench_name("Writer", i), iterations);
+        M2_CONNECT(*r, out_port, *c, read_port);
+        M2_CONNECT(*w, out_port, *c, write_port);
+        c->set_func_arch_flag(0);
+        r->set_func_arch_flag(0);
+        w->set_func_arch_flag(0);
+        readers.push_back(r);
+        writers.push_back(w);
+    }
+
+    // architecture model, task t runs on processor t % procs
+    std::vector<Reader_Task *> reader_tasks;
+    std::vector<Writer_Task *> writer_tasks;
+    std::vector<Processor *> processors;
+    for (int p = 0; (p < procs) && (tasks > 0); p++)
+    {
+        Processor* proc = new Processor(bench_name("Processor", p));
+        proc->set_func_arch_flag(1);
+        processors.push_back(proc);
+    }
+    for (int t = 0; t < tasks; t++)
+    {
+        Reader_Task* rt = new Reader_Task(bench_name("Reader_Task", t));
+        Writer_Task* wt = new Writer_Task(bench_name("Writer_Task", t));
+        M2_CONNECT(*rt, read_port, *processors[t % procs], read_port);
+        M2_CONNECT(*wt, write_port, *processors[t % procs], write_port);
+        rt->set_func_arch_flag(1);
+        wt->set_func_arch_flag(1);
+        reader_tasks.push_back(rt);
+        writer_tasks.push_back(wt);
+    }
+
+    // mapping: the first mapped pairs share task 0, the next ones task 1, ...
+    m2_constraint_solver* mapping_constraints = new m2_constraint_solver();
+    register_constraint_solver(mapping_constraints);
+    m2_rendez_group_constraint* group = NULL;
+    if (fanin > 1)
+    {
+        group = new m2_rendez_group_constraint("mapping");
+        mapping_constraints->addConstraint(group);
+    }
+    for (int i = 0; i < mapped; i++)
+    {
+        Reader& r = *readers[i];
+        Writer& w = *writers[i];
+        Reader_Task& rt = *reader_tasks[i / fanin];
+        Writer_Task& wt = *writer_tasks[i / fanin];
+        if (group != NULL)
+        {
+            M2_MAP_GROUP(group, r, receive, rt, receive);
+            M2_MAP_GROUP(group, w, send, wt, send);
+        }
+        else {
+            M2_MAP(r, receive, rt, receive);
+            M2_MAP(w, send, wt, send);
+        }
+    }
+
+    // execution times of the tasks
+    std::vector<m2_event *> ptime_event_list;
+    std::map<const char*, double, ltstr>* ptime_table = new std::map<const char*, double, ltstr>();
+    for (int t = 0; t < tasks; t++)
+    {
+        ptime_event_list.push_back(reader_tasks[t]->receive_event_end);
+        ptime_event_list.push_back(writer_tasks[t]->send_event_end);
+        (*ptime_table)[reader_tasks[t]->receive_event_end->get_full_name()] = 0.5 + 0.25 * (t % 4);
+        (*ptime_table)[writer_tasks[t]->send_event_end->get_full_name()] = 1 + 0.5 * (t % 3);
+    }
+    register_annotator(new m2_physical_time_annotator("pt_annotator", ptime_event_list, ptime_table));
+
+    // one round robin scheduler per processor for its writer tasks and one for its reader tasks
+    for (int p = 0; use_rr && (p < (int)processors.size()); p++)
+    {
+        m2_round_robin_scheduler* rr_write = new m2_round_robin_scheduler(bench_name("rr_write", p));
+        m2_round_robin_scheduler* rr_read = new m2_round_robin_scheduler(bench_name("rr_read", p));
+        for (int t = p; t < tasks; t += procs)
+        {
+            rr_write->add_event(writer_tasks[t]->send_event_beg);
+            rr_write->add_event(writer_tasks[t]->send_event_end);
+            rr_read->add_event(reader_tasks[t]->receive_event_beg);
+            rr_read->add_event(reader_tasks[t]->receive_event_end);
+        }
+        register_scheduler(rr_write);
+        register_scheduler(rr_read);
+    }
+
+    if (use_lt && (tasks > 0))
+    {
+        m2_logical_time_scheduler* ltime = new m2_logical_time_scheduler("lt_scheduler", 2 * tasks);
+        for (int t = 0; t < tasks; t++)
+        {
+            ltime->add_event(reader_tasks[t]->receive_event_beg);
+            ltime->add_event(reader_tasks[t]->receive_event_end);
+            ltime->add_event(writer_tasks[t]->send_event_beg);
+            ltime->add_event(writer_tasks[t]->send_event_end);
+        }
+        register_scheduler(ltime);
+    }
+
+    manager.enable_stats(true);
+    m2_start();
+
+    m2_phase_stats& stats = manager.get_stats();
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    cout << "bench_iterations_per_second: " << stats.iterations() / stats.seconds() << endl;
+    cout << "bench_events_per_second: " << stats.events_enabled() / stats.seconds() << endl;
+    cout << "bench_peak_rss_kb: " << usage.ru_maxrss << endl;
+
+    return 0;
+}
@@ -10,9 +10,9 @@
 #include "m2_component.h"
 #include "m2_ports.h"
 #include "m2_manager.h"
+#include "m2_random.h"
 
 #include <deque>
-#include <time.h>
 
 namespace m2_core{
 
@@ -26,6 +26,15 @@ namespace m2_core{
             if (get_connected_obj())
                 ((typeof(this))get_connected_obj())->write_event_info(e_info);
         }
+
+        // interface for adaptors (without proposing events): copies n infos
+        // into the channel, returns how many were written
+        virtual int write_n(const m2_event_info* infos, int n)
+        {
+            if (get_connected_obj())
+                return ((typeof(this))get_connected_obj())->write_n(infos, n);
+            return 0;
+        }
     };
 
     class i_ac_read : public m2_interface
@@ -42,6 +51,15 @@ namespace m2_core{
                 ret = NULL;
             return ret;
         }
+
+        // interface for adaptors: copies up to n infos out of the channel,
+        // returns how many were read
+        virtual int read_n(m2_event_info* out, int n)
+        {
+            if (get_connected_obj())
+                return ((typeof(this))get_connected_obj())->read_n(out, n);
+            return 0;
+        }
     };
 
     class adaptor_channel : public i_ac_write, public i_ac_read
@@ -92,6 +110,190 @@ namespace m2_core{
             }
         }
 
+        // element by element on the list: the written infos are allocated
+        // copies, the read ones are deleted once copied to out
+        int write_n(const m2_event_info* infos, int n)
+        {
+            int i = 0;
+            for (; (i < n) && ((int)event_info_list.size() != maxSize); i++)
+            {
+                event_info_list.push_back(new m2_event_info(infos[i]));
+            }
+            if (i < n)
+                M2_DEBUG1("event channel is full while writing");
+            return i;
+        }
+
+        int read_n(m2_event_info* out, int n)
+        {
+            int i = 0;
+            for (; (i < n) && !event_info_list.empty(); i++)
+            {
+                out[i] = *event_info_list.front();
+                delete event_info_list.front();
+                event_info_list.pop_front();
+            }
+            return i;
+        }
+    };
+
+    // what a ring adaptor channel does with the infos written while it is full
+    enum M2_Full_Policy
+    {
+        M2_FULL_BLOCK,          // the writer waits (m2_wait) for the reader
+        M2_FULL_OVERWRITE,      // the oldest infos are overwritten (new infos
+                                // beyond the capacity of a batch are dropped)
+        M2_FULL_DROP            // the new infos are dropped and counted
+    };
+
+    //******************************************************************************
+    // Adaptor channel on a ring buffer
+    //******************************************************************************
+    // The infos are stored by value in a ring allocated once, whose capacity
+    // is rounded up to a power of 2, and are copied in and out in batches by
+    // write_n and read_n. There is one writer and one reader; both run in
+    // SystemC processes, which do not preempt each other, so the indices
+    // need no synchronization.
+    //
+    // write_event_info and read_event_info are kept for existing adaptors:
+    // as with adaptor_channel, the first takes ownership of the info (it is
+    // copied and deleted), the second returns a copy allocated from
+    // event_info_pool, owned by the caller.
+    class ring_adaptor_channel : public i_ac_write, public i_ac_read
+    {
+      protected:
+        std::vector<m2_event_info> ring;
+        unsigned long mask;         // capacity - 1
+        unsigned long head;         // infos written so far
+        unsigned long tail;         // infos read or overwritten so far
+        M2_Full_Policy policy;
+        unsigned long dropped;      // new infos never stored
+        unsigned long overwritten;  // stored infos overwritten before being read
+        sc_event read_event;        // notified after reads, for M2_FULL_BLOCK
+
+        void init(int capacity, M2_Full_Policy _policy)
+        {
+            unsigned long size = 1;
+            while (size < (unsigned long)capacity)
+                size <<= 1;
+            ring.resize(size);
+            mask = size - 1;
+            head = 0;
+            tail = 0;
+            policy = _policy;
+            dropped = 0;
+            overwritten = 0;
+        }
+
+        // copy n infos to the ring, which has room for them
+        void copy_in(const m2_event_info* infos, int n)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                ring[(head + i) & mask] = infos[i];
+            }
+            head += n;
+        }
+
+      public:
+        m2_provided_port<i_ac_write> write_port;
+        m2_provided_port<i_ac_read> read_port;
+
+        ring_adaptor_channel(int capacity = 64, M2_Full_Policy _policy = M2_FULL_DROP)
+        {
+            init(capacity, _policy);
+        }
+
+        void set_full_policy(M2_Full_Policy _policy)
+        {
+            policy = _policy;
+        }
+
+        int capacity()
+        {
+            return ring.size();
+        }
+
+        int size()
+        {
+            return head - tail;
+        }
+
+        unsigned long get_dropped()
+        {
+            return dropped;
+        }
+
+        unsigned long get_overwritten()
+        {
+            return overwritten;
+        }
+
+        // returns n, except with M2_FULL_DROP where the dropped infos are
+        // not counted
+        int write_n(const m2_event_info* infos, int n)
+        {
+            int written = 0;
+            while (written < n)
+            {
+                int room = ring.size() - size();
+                int count = std::min(room, n - written);
+                copy_in(infos + written, count);
+                written += count;
+                if (written == n)
+                    break;
+
+                if (policy == M2_FULL_BLOCK)
+                {
+                    M2_DEBUG1("ring channel is full while writing, waiting for the reader");
+                    m2_wait(read_event);
+                }
+                else if (policy == M2_FULL_OVERWRITE)
+                {
+                    // only the last capacity infos survive
+                    int skip = std::max(n - written - (int)ring.size(), 0);
+                    int kept = n - written - skip;
+                    dropped += skip;
+                    overwritten += kept;
+                    tail += kept;
+                    copy_in(infos + written + skip, kept);
+                    written = n;
+                }
+                else {
+                    dropped += n - written;
+                    M2_DEBUG1("ring channel is full while writing, " << n - written << " infos dropped");
+                    return written;
+                }
+            }
+            return written;
+        }
+
+        int read_n(m2_event_info* out, int n)
+        {
+            int count = std::min(n, size());
+            for (int i = 0; i < count; i++)
+            {
+                out[i] = ring[(tail + i) & mask];
+            }
+            tail += count;
+            if ((count > 0) && (policy == M2_FULL_BLOCK))
+                read_event.notify();
+            return count;
+        }
+
+        void write_event_info(m2_event_info* e_info)
+        {
+            write_n(e_info, 1);
+            delete e_info;
+        }
+
+        m2_event_info* read_event_info()
+        {
+            m2_event_info e_info;
+            if (read_n(&e_info, 1) == 0)
+                return NULL;
+            return new m2_event_info(e_info);
+        }
     };
 
     class adaptor : public m2_component
@@ -176,14 +378,14 @@ namespace m2_core{
         {
             timeTag = 0;
             range = 10;
-            srand( time(NULL) );
+            seeded = false;
         }
 
         df_fsm_adaptor(sc_module_name n, int _range) : adaptor(n)
         {
             timeTag = 0;
             range = _range;
-            srand( time(NULL) );
+            seeded = false;
         }
 
         void set_range(int _range)
@@ -191,6 +393,14 @@ namespace m2_core{
             range = _range;
         }
 
+        // the delays are drawn from the stream keyed by the seed and the name
+        // of the adaptor; m2_random_seed is used if no seed is set
+        void set_seed(uint64_t seed)
+        {
+            random.set_key(seed, m2_random_stream::key_of(name()));
+            seeded = true;
+        }
+
         void read_events()
         {
             M2_DEBUG1("-----read events in adaptor-----");
@@ -207,10 +417,14 @@ namespace m2_core{
         void transform_events()
         {
             M2_DEBUG1("-----transform events in adaptor-----");
+            if (!seeded)
+                set_seed(m2_random_seed);
+            delays.resize(internal_event_info_list.size());
+            if (!delays.empty())
+                random.uniform_int(&delays[0], delays.size(), 1, range);
             for (unsigned int i=0; i<internal_event_info_list.size(); i++)
             {
-                int addTime = rand() % range + 1;
-                timeTag += addTime;
+                timeTag += delays[i];
                 internal_event_info_list[i]->tag = timeTag;
             }
         }
@@ -230,6 +444,9 @@ namespace m2_core{
 
         int timeTag;
         int range;
+        bool seeded;
+        m2_random_stream random;
+        std::vector<int> delays;
     };
 
     class fsm_df_adaptor : public adaptor
@@ -7,8 +7,12 @@
 
 #include "m2_base.h"
 #include "m2_debug.h"
+#include "m2_log.h"
 #include "m2_event.h"
+#include "m2_parallel.h"
+#include "m2_cost_table.h"
 #include <assert.h>
+#include <limits>
 
 namespace m2_core { // begin namespace m2_core 
 
@@ -16,33 +20,77 @@ namespace m2_core { // begin namespace m2_core
     //**************************************************************
     // MetroII annotator 
     //**************************************************************    
+    // The footprint of an annotator is the list of quantities (e.g. "tag",
+    // "val") it reads and writes on the events of its _event_list. Two
+    // annotators conflict when one writes a quantity the other reads or
+    // writes on a common event; conflicting annotators are never run
+    // concurrently. An annotator that declares nothing conflicts with all
+    // the others.
+    //
+    // annotate() may run on a worker thread of the annotation runner, where
+    // SystemC must not be called; errors found there are given to
+    // defer_error() and reported by the runner on the simulation thread.
     class m2_annotator
     {
       protected:
         const char* _name;
         std::vector<m2_event *> _event_list;
+        bool _has_footprint;
+        std::vector<const char *> _reads;   // interned quantity names
+        std::vector<const char *> _writes;
+        std::string _error;                 // first deferred error, empty if none
+
+        void defer_error(const std::string& msg)
+        {
+            if (_error.empty())
+                _error = msg;
+        }
+
+        static bool intersect(const std::vector<const char *>& a, const std::vector<const char *>& b)
+        {
+            for (unsigned i = 0; i < a.size(); i++)
+            {
+                if (std::find(b.begin(), b.end(), a[i]) != b.end())
+                    return true;
+            }
+            return false;
+        }
+
+        void sorted_ids(std::vector<int>& ids)
+        {
+            ids.clear();
+            for (unsigned i = 0; i < _event_list.size(); i++)
+            {
+                ids.push_back(_event_list[i]->get_id());
+            }
+            std::sort(ids.begin(), ids.end());
+        }
 
       public:
         m2_annotator()
         {
             _name = "unknown";
+            _has_footprint = false;
         }
 
         m2_annotator(const char* name)
         {
             _name = name; 
+            _has_footprint = false;
         }
 
         m2_annotator(const std::vector<m2_event *> event_list)
         {
             _name = "unknown"; 
             _event_list= event_list;
+            _has_footprint = false;
         }
 
         m2_annotator(const char* name, const std::vector<m2_event *> event_list)
         {
             _name = name; 
             _event_list= event_list;
+            _has_footprint = false;
         }
 
         void add_event(m2_event* e)
@@ -52,41 +100,471 @@ namespace m2_core { // begin namespace m2_core
 
         virtual ~m2_annotator() {}
 
+        const char* name()
+        {
+            return _name;
+        }
+
+        void declare_read(const char* quantity)
+        {
+            _reads.push_back(name_arena.intern(quantity));
+            _has_footprint = true;
+        }
+
+        void declare_write(const char* quantity)
+        {
+            _writes.push_back(name_arena.intern(quantity));
+            _has_footprint = true;
+        }
+
+        bool conflicts(m2_annotator* a)
+        {
+            if (!_has_footprint || !a->_has_footprint)
+                return true;
+            if (!intersect(_writes, a->_writes) && !intersect(_writes, a->_reads) 
+                    && !intersect(_reads, a->_writes))
+                return false;
+
+            std::vector<int> ids, other_ids;
+            sorted_ids(ids);
+            a->sorted_ids(other_ids);
+            unsigned i = 0, j = 0;
+            while ((i < ids.size()) && (j < other_ids.size()))
+            {
+                if (ids[i] == other_ids[j])
+                    return true;
+                if (ids[i] < other_ids[j])
+                    i++;
+                else
+                    j++;
+            }
+            return false;
+        }
+
+        // reports the deferred error, if any; called on the simulation thread
+        void report_errors()
+        {
+            if (_error.empty())
+                return;
+            std::string msg = _error;
+            _error.clear();
+            SC_REPORT_ERROR(_name, msg.c_str());
+        }
+
+        // called by m2_start once the design is built
+        virtual void elaborate() {}
 
         virtual void annotate() = 0;
     };
 
+    //**************************************************************
+    // MetroII batch annotator 
+    //**************************************************************    
+    // Annotates the proposed events of its _event_list given as an array
+    // of event IDs. The manager builds the batches from its pending events
+    // (m2_batch_dispatcher), so the work depends on the number of proposed
+    // events rather than on the number of registered ones; when annotate()
+    // is called without a batch, the annotator builds it by scanning its
+    // events.
+    class m2_batch_annotator : public m2_annotator
+    {
+      protected:
+        std::vector<int> _batch;
+        bool _batch_ready;
+
+      public:
+        m2_batch_annotator()
+            : m2_annotator()
+        {
+            _batch_ready = false;
+        }
+
+        m2_batch_annotator(const char* name)
+            : m2_annotator(name)
+        {
+            _batch_ready = false;
+        }
+
+        m2_batch_annotator(const std::vector<m2_event *> event_list)
+            : m2_annotator(event_list)
+        {
+            _batch_ready = false;
+        }
+
+        m2_batch_annotator(const char* name, const std::vector<m2_event *> event_list)
+            : m2_annotator(name, event_list)
+        {
+            _batch_ready = false;
+        }
+
+        std::vector<m2_event *>& get_events()
+        {
+            return _event_list;
+        }
+
+        // called by the dispatcher
+        void begin_batch()
+        {
+            _batch.clear();
+            _batch_ready = true;
+        }
+
+        void add_to_batch(int id)
+        {
+            _batch.push_back(id);
+        }
+
+        void annotate()
+        {
+            if (!_batch_ready)
+            {
+                _batch.clear();
+                for (unsigned i = 0; i < _event_list.size(); i++)
+                {
+                    if (_event_list[i]->get_status() == (char)M2_EVENT_PROPOSED)
+                        _batch.push_back(_event_list[i]->get_id());
+                }
+            }
+            _batch_ready = false;
+            if (!_batch.empty())
+                annotate_batch(_batch.data(), _batch.size());
+        }
+
+        virtual void annotate_batch(const int* ids, int n) = 0;
+    };
+
+    //**************************************************************
+    // Batches of the batch annotators
+    //**************************************************************    
+    // Keeps, for every event ID, the batch annotators having the event, and
+    // hands each pending proposed event to them. The index is rebuilt when
+    // annotators or events are added.
+    class m2_batch_dispatcher
+    {
+      private:
+        std::vector<m2_batch_annotator *> _annotators;
+        std::vector<std::vector<int> > _members;    // by event ID: positions in _annotators
+        unsigned _registered;                       // number of annotators of the manager
+        std::vector<unsigned> _sizes;               // event counts of _annotators
+
+        bool stale(std::vector<m2_annotator *>& annotators)
+        {
+            if (annotators.size() != _registered)
+                return true;
+            for (unsigned i = 0; i < _annotators.size(); i++)
+            {
+                if (_annotators[i]->get_events().size() != _sizes[i])
+                    return true;
+            }
+            return false;
+        }
+
+        void build(std::vector<m2_annotator *>& annotators)
+        {
+            _annotators.clear();
+            _sizes.clear();
+            _members.assign(event_table.size(), std::vector<int>());
+            for (unsigned i = 0; i < annotators.size(); i++)
+            {
+                m2_batch_annotator* a = dynamic_cast<m2_batch_annotator *>(annotators[i]);
+                if (a == NULL)
+                    continue;
+                int k = _annotators.size();
+                _annotators.push_back(a);
+                _sizes.push_back(a->get_events().size());
+                for (unsigned j = 0; j < a->get_events().size(); j++)
+                {
+                    std::vector<int>& members = _members[a->get_events()[j]->get_id()];
+                    if (members.empty() || (members.back() != k))
+                        members.push_back(k);
+                }
+            }
+            _registered = annotators.size();
+        }
+
+      public:
+        m2_batch_dispatcher()
+        {
+            _registered = 0;
+        }
+
+        void elaborate(std::vector<m2_annotator *>& annotators)
+        {
+            build(annotators);
+        }
+
+        void dispatch(std::vector<m2_annotator *>& annotators, std::vector<m2_event *>& pending)
+        {
+            if (stale(annotators))
+                build(annotators);
+            if (_annotators.empty())
+                return;
+
+            for (unsigned i = 0; i < _annotators.size(); i++)
+            {
+                _annotators[i]->begin_batch();
+            }
+            for (unsigned i = 0; i < pending.size(); i++)
+            {
+                if (pending[i]->get_status() != (char)M2_EVENT_PROPOSED)
+                    continue;
+                int id = pending[i]->get_id();
+                if (id >= (int)_members.size())
+                    continue;
+                for (unsigned k = 0; k < _members[id].size(); k++)
+                {
+                    _annotators[_members[id][k]]->add_to_batch(id);
+                }
+            }
+        }
+    };
+
+    enum M2_Annotation_Mode
+    {
+        M2_ANNOTATE_SEQUENTIAL,     // in registration order on the simulation thread
+        M2_ANNOTATE_PARALLEL,       // conflicting annotators run one at a time, in any order
+        M2_ANNOTATE_DETERMINISTIC   // conflicting annotators run in registration order
+    };
+
+    //**************************************************************
+    // Phase 2 execution
+    //**************************************************************    
+    // Runs the annotators of the manager on a thread pool. Every thread
+    // repeatedly takes the first annotator, in registration order, that can
+    // start: in the parallel mode none of its conflicting annotators is
+    // running, in the deterministic mode all of its conflicting annotators
+    // registered before it have finished, so each annotator sees the same
+    // values as in a sequential run whatever the number of threads. The
+    // conflicts are computed on the first run and again when annotators are
+    // added, or after invalidate() if footprints change later.
+    class m2_annotation_runner
+    {
+      private:
+        M2_Annotation_Mode _mode;
+        m2_thread_pool _pool;
+        std::vector<m2_annotator *>* _annotators;
+        std::vector<std::vector<int> > _conflicts;
+        unsigned _analyzed;             // number of annotators when the conflicts were computed
+
+        std::mutex _mutex;
+        std::condition_variable _changed;
+        std::vector<char> _state;       // 0 not started, 1 running, 2 finished
+        unsigned _first;                // first annotator not started
+        unsigned _started;
+
+        void analyze(std::vector<m2_annotator *>& annotators)
+        {
+            if (_analyzed == annotators.size())
+                return;
+            _conflicts.assign(annotators.size(), std::vector<int>());
+            for (unsigned i = 0; i < annotators.size(); i++)
+            {
+                for (unsigned j = i + 1; j < annotators.size(); j++)
+                {
+                    if (annotators[i]->conflicts(annotators[j]))
+                    {
+                        _conflicts[i].push_back(j);
+                        _conflicts[j].push_back(i);
+                    }
+                }
+            }
+            _analyzed = annotators.size();
+        }
+
+        bool can_start(unsigned i)
+        {
+            for (unsigned k = 0; k < _conflicts[i].size(); k++)
+            {
+                unsigned j = _conflicts[i][k];
+                if (_state[j] == 1)
+                    return false;
+                if ((_mode == M2_ANNOTATE_DETERMINISTIC) && (j < i) && (_state[j] != 2))
+                    return false;
+            }
+            return true;
+        }
+
+        // next annotator to run, -1 if none can start now
+        int pick()
+        {
+            while ((_first < _state.size()) && (_state[_first] != 0))
+                _first++;
+            for (unsigned i = _first; i < _state.size(); i++)
+            {
+                if ((_state[i] == 0) && can_start(i))
+                    return i;
+            }
+            return -1;
+        }
+
+        void work()
+        {
+            std::vector<m2_annotator *>& annotators = *_annotators;
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (_started < _state.size())
+            {
+                int i = pick();
+                if (i < 0)
+                {
+                    _changed.wait(lock);
+                    continue;
+                }
+                _state[i] = 1;
+                _started++;
+                lock.unlock();
+                annotators[i]->annotate();
+                lock.lock();
+                _state[i] = 2;
+                _changed.notify_all();
+            }
+        }
+
+      public:
+        m2_annotation_runner()
+        {
+            _mode = M2_ANNOTATE_SEQUENTIAL;
+            _annotators = NULL;
+            _analyzed = 0;
+            _first = 0;
+            _started = 0;
+        }
+
+        // threads includes the simulation thread
+        void set_mode(M2_Annotation_Mode mode, int threads)
+        {
+            _mode = mode;
+            _pool.resize((mode == M2_ANNOTATE_SEQUENTIAL) ? 1 : std::max(threads, 1));
+        }
+
+        M2_Annotation_Mode get_mode()
+        {
+            return _mode;
+        }
+
+        int get_threads()
+        {
+            return _pool.size();
+        }
+
+        void invalidate()
+        {
+            _analyzed = 0;
+            _conflicts.clear();
+        }
+
+        void run(std::vector<m2_annotator *>& annotators)
+        {
+            if ((_mode == M2_ANNOTATE_SEQUENTIAL) || (_pool.size() == 1) || (annotators.size() < 2))
+            {
+                for (unsigned i = 0; i < annotators.size(); i++)
+                    annotators[i]->annotate();
+            }
+            else
+            {
+                analyze(annotators);
+                _annotators = &annotators;
+                _state.assign(annotators.size(), 0);
+                _first = 0;
+                _started = 0;
+                _pool.run([this] () { work(); });
+            }
+
+            for (unsigned i = 0; i < annotators.size(); i++)
+                annotators[i]->report_errors();
+        }
+    };
+
+    // what the physical time annotator does with an event that has no entry
+    // in its time table
+    enum M2_Missing_Cost_Policy
+    {
+        M2_MISSING_COST_DEFAULT,    // the tag is set to the default cost (0 unless set)
+        M2_MISSING_COST_KEEP,       // the tag is left unchanged
+        M2_MISSING_COST_ERROR       // error reported when the table is resolved
+    };
+
     //**************************************************************
     // MetroII physical time annotator  
     //**************************************************************
+    // The time table maps full event names (owner name followed by event
+    // name) to execution times. It is resolved once into an array of costs
+    // indexed by position in _event_list, at elaboration and again when
+    // events or entries are added, so annotate() does no lookup. Events
+    // without an entry in the time table are looked up in the cost table
+    // file, if one is set. The costs go to the tag, or to another quantity
+    // given to set_output (e.g. an energy table).
     class m2_physical_time_annotator : public m2_annotator
     {
       protected:
         std::map<const char*, double, ltstr>* _time_table;
+        m2_cost_table* _cost_table;
+        int _output;                    // quantity written
+        M2_Missing_Cost_Policy _missing_policy;
+        double _default_cost;
+        unsigned _resolved;             // events of _event_list with a resolved cost
+        std::vector<int> _event_ids;
+        std::vector<double> _costs;     // by position in _event_list
+        std::vector<char> _has_cost;
+
+        void init()
+        {
+            declare_write("tag");
+            _cost_table = NULL;
+            _output = M2_QUANTITY_TAG;
+            _missing_policy = M2_MISSING_COST_DEFAULT;
+            _default_cost = 0;
+            _resolved = 0;
+        }
+
+        void resolve()
+        {
+            _event_ids.resize(_event_list.size());
+            _costs.resize(_event_list.size());
+            _has_cost.resize(_event_list.size());
+            for (unsigned i = _resolved; i < _event_list.size(); i++)
+            {
+                _event_ids[i] = _event_list[i]->get_id();
+                const char* full_name = _event_list[i]->get_full_name();
+                std::map<const char*, double, ltstr>::iterator it = _time_table->find(full_name);
+                _has_cost[i] = (it != _time_table->end());
+                _costs[i] = _has_cost[i] ? it->second : _default_cost;
+                if (!_has_cost[i] && (_cost_table != NULL))
+                    _has_cost[i] = _cost_table->lookup(full_name, _costs[i]);
+                if (!_has_cost[i] && (_missing_policy == M2_MISSING_COST_ERROR))
+                    defer_error(std::string("no execution time for event ") + _event_list[i]->get_full_name());
+                if (_missing_policy == M2_MISSING_COST_DEFAULT)
+                    _has_cost[i] = 1;
+            }
+            _resolved = _event_list.size();
+        }
 
       public:
         m2_physical_time_annotator() 
             : m2_annotator()
         {
             _time_table = new std::map<const char*, double, ltstr>();
+            init();
         }
 
         m2_physical_time_annotator(const char* name) 
             : m2_annotator(name)
         {
             _time_table = new std::map<const char*, double, ltstr>();
+            init();
         }
 
         m2_physical_time_annotator(const std::vector<m2_event *> event_list) 
             : m2_annotator(event_list)
         {
             _time_table = new std::map<const char*, double, ltstr>();
+            init();
         }
 
         m2_physical_time_annotator(const char* name, const std::vector<m2_event *> event_list) 
             : m2_annotator(name, event_list)
         {
             _time_table = new std::map<const char*, double, ltstr>();
+            init();
         }
 
         m2_physical_time_annotator(const std::vector<m2_event *> event_list, 
@@ -94,6 +572,7 @@ namespace m2_core { // begin namespace m2_core
             : m2_annotator(event_list)
         {
             _time_table = time_table;
+            init();
         }
 
 
@@ -102,25 +581,66 @@ namespace m2_core { // begin namespace m2_core
             : m2_annotator(name, event_list)
         {
             _time_table = time_table;
+            init();
         }
 
         void add_time_table_entry(const char* event_name, double exec_time)
         {
             (*_time_table)[event_name] = exec_time;
+            _resolved = 0;
+        }
+
+        // costs of the events missing from the time table; the table is
+        // only read while resolving and must stay open until then
+        void set_cost_table(m2_cost_table* cost_table)
+        {
+            _cost_table = cost_table;
+            _resolved = 0;
+        }
+
+        // write the costs to the given quantity instead of the tag,
+        // registered if needed
+        void set_output(const char* quantity)
+        {
+            _output = event_table.register_quantity(quantity);
+            declare_write(quantity);
+        }
+
+        void set_missing_cost_policy(M2_Missing_Cost_Policy policy, double default_cost = 0)
+        {
+            _missing_policy = policy;
+            _default_cost = default_cost;
+            _resolved = 0;
+        }
+
+        // the time table was changed directly, resolve it again
+        void invalidate()
+        {
+            _resolved = 0;
+        }
+
+        void elaborate()
+        {
+            resolve();
+            report_errors();
         }
 
+        // resolving again here is done on a worker thread in the parallel
+        // modes, a missing cost is reported after the annotation phase
         void annotate()
         {
-            char *tmpstr;
+            if (_resolved != _event_list.size())
+                resolve();
 
-            for (unsigned i = 0; i < _event_list.size(); i ++)
+            const char* status = event_table.status_data();
+            std::vector<double>& output = event_table.column(_output);
+            for (unsigned i = 0; i < _event_ids.size(); i ++)
             {
-                M2_DEBUG3(_event_list[i]->get_full_name() << " " << _event_list[i]->string_status());
-                if (_event_list[i]->get_status() == (char)M2_EVENT_PROPOSED)
+                int id = _event_ids[i];
+                if ((status[id] == (char)M2_EVENT_PROPOSED) && _has_cost[i])
                 {
-                    STR_CAT(tmpstr, _event_list[i]->get_owner().name(), _event_list[i]->name());
-                    _event_list[i]->tag = (*_time_table)[(const char*)tmpstr];
-                    free(tmpstr);
+                    M2_DEBUG3(_event_list[i]->get_full_name() << " " << _event_list[i]->string_status());
+                    output[id] = _costs[i];
                 }
             }
         }
@@ -130,12 +650,73 @@ namespace m2_core { // begin namespace m2_core
     //**************************************************************
     // MetroII scheduler 
     //**************************************************************    
+    // A scheduler whose uses_watchers() returns true is only called by the
+    // manager when one of its events changed status since its previous call,
+    // or when touch() was called (state changed other than through the
+    // events); its events must be added with add_event or the list
+    // constructors. The other schedulers are called in every round.
     class m2_scheduler
     {
       protected:
         const char* _name;
         std::vector<m2_event *> _event_list;
+        std::vector<int> _event_ids;    // IDs of _event_list, to scan the event table
         bool stable;
+        m2_worklist _touched;           // not empty when schedule() has to run
+
+        void set_event_ids()
+        {
+            _event_ids.clear();
+            for (unsigned i = 0; i < _event_list.size(); i++)
+            {
+                _event_ids.push_back(_event_list[i]->get_id());
+                _event_list[i]->add_watcher(&_touched, 0);
+            }
+        }
+
+        void init_touched()
+        {
+            _touched.resize(1);
+            _touched.push(0);
+        }
+
+        // type of an event for the schedulers: generic events named "..b" or
+        // "..e" are taken as begin and end events
+        static M2_Event_Types event_type(m2_event* e)
+        {
+            if (e->get_type() != M2_EVENT_GENERIC)
+                return e->get_type();
+            const char* name = e->name();
+            int len = strlen(name);
+            if ((len > 0) && (name[len - 1] == 'b'))
+                return M2_EVENT_BEGIN;
+            if ((len > 0) && (name[len - 1] == 'e'))
+                return M2_EVENT_END;
+            return M2_EVENT_GENERIC;
+        }
+
+        // generic begin and end events of the same request have the same
+        // owner and the same name apart from the last character
+        static bool same_request(m2_event* b, m2_event* e)
+        {
+            int len = strlen(e->name());
+            return (b->get_owner() == e->get_owner()) && ((int)strlen(b->name()) == len)
+                && (strncmp(b->name(), e->name(), len - 1) == 0);
+        }
+
+        // equal for the events of the same request (see same_request), to
+        // pair them through a map; false for events without owner, which
+        // are never of the same request
+        static bool request_key(m2_event* e, std::string& key)
+        {
+            if (!e->get_owner().valid())
+                return false;
+            int len = strlen(e->name());
+            key = e->get_owner().name();
+            key.push_back('\0');
+            key.append(e->name(), (len > 0) ? len - 1 : 0);
+            return true;
+        }
 
       public:
 
@@ -146,32 +727,93 @@ namespace m2_core { // begin namespace m2_core
         m2_scheduler()
         {
             _name = "unknown";
+            init_touched();
         }
 
         m2_scheduler(const char* name)
         {
             _name = name; 
+            init_touched();
         }
 
         m2_scheduler(const std::vector<m2_event *> event_list)
         {
             _name = "unknown"; 
+            init_touched();
             _event_list= event_list;
+            set_event_ids();
         }
 
         m2_scheduler(const char* name, const std::vector<m2_event *> event_list)
         {
             _name = name; 
+            init_touched();
             _event_list= event_list;
+            set_event_ids();
         }
 
         void add_event(m2_event* e)
         {
             _event_list.push_back(e);
+            _event_ids.push_back(e->get_id());
+            e->add_watcher(&_touched, 0);
+            touch();
+        }
+
+        // the scheduler is only run when touched, see above
+        virtual bool uses_watchers()
+        {
+            return false;
+        }
+
+        // schedule() has to run in the next round even if no event changed
+        void touch()
+        {
+            _touched.push(0);
+        }
+
+        bool touched()
+        {
+            return !_touched.empty() || !uses_watchers();
+        }
+
+        // called by the manager before schedule()
+        void clear_touched()
+        {
+            if (!_touched.empty())
+            {
+                _touched.done(_touched.pop());
+            }
+        }
+
+        std::vector<m2_event *>& get_events()
+        {
+            return _event_list;
+        }
+
+        // a global scheduler is run by the simulation thread between the
+        // parallel runs of the phase 3 clusters, and does not join the
+        // clusters of its events
+        virtual bool is_global()
+        {
+            return type == 1;
+        }
+
+        // phase 3 cluster running the scheduler, -1 for a global one;
+        // schedulers watching events through their own worklists set
+        // them to the cluster too
+        virtual void set_cluster(int cluster)
+        {
+            _touched.set_cluster(cluster);
         }
 
         virtual ~m2_scheduler() {}
 
+        // called by m2_start once the design is built, on the simulation
+        // thread; schedulers that index their events do it here, so that a
+        // phase 3 cluster thread never has to
+        virtual void elaborate() {}
+
         virtual void update_end_process(sc_process_handle proc) = 0;
 
         virtual void schedule() = 0;
@@ -184,18 +826,19 @@ namespace m2_core { // begin namespace m2_core
     //**************************************************************
     // MetroII logical time scheduler 
     //**************************************************************    
-    struct ltevent
-    {
-        bool operator()(m2_event* e1, m2_event* e2) const
-        {
-            if (e1->get_owner() == e2->get_owner())
-                return strncmp(e1->name(), e2->name(), strlen(e1->name()) - 1) < 0;
-            else
-                return (((sc_process_b*) (sc_process_handle) e1->get_owner()) < 
-                        ((sc_process_b*) (sc_process_handle) e2->get_owner()));
-        }
-    };
-
+    // The scheduler waits until every process using it has proposed an event,
+    // then enables the end events with the earliest completion time (time of
+    // the begin event plus the tag of the end event) and advances the global
+    // time to it.
+    //
+    // Begin and end events are kept in separate arrays, the pending end events
+    // in a min-heap keyed by completion time. Events are watched, and
+    // schedule() only looks at the events whose status changed since its last
+    // call; post_schedule() only at those that changed during the iteration.
+    // Events created by the method wrappers carry their type and partner; for
+    // generic events the type is taken from the last character of the name
+    // ('b' or 'e') and the partner is the event with the same owner and name
+    // apart from that character.
     class m2_logical_time_scheduler : public m2_scheduler
     {
       protected:
@@ -203,42 +846,250 @@ namespace m2_core { // begin namespace m2_core
         double _current_time;
         double current_next_time;
         bool existDisabled;
-        std::map<m2_event *, double, ltevent> _beg_time_table;
         std::vector<sc_process_handle> _process_list;
+        unsigned _indexed;                  // events of _event_list already sorted into the arrays
 
-      public:
-        m2_logical_time_scheduler(int _total_requests) 
-            : m2_scheduler()
+        std::vector<m2_event *> _begins;
+        std::vector<double> _begin_time;    // time at which the begin event was proposed
+        std::vector<char> _begin_state;     // 1 proposed, 2 waiting or disabled, 0 otherwise
+        std::map<m2_event *, int> _begin_index;
+        std::map<std::string, int> _begin_request;      // first begin event of each request key
+
+        // end events whose begin event is not known yet, by partner or by request key
+        std::multimap<m2_event *, int> _unpaired_by_partner;
+        std::multimap<std::string, int> _unpaired_by_request;
+
+        std::vector<m2_event *> _ends;
+        std::vector<int> _end_partner;      // index in _begins, -1 if none
+        std::vector<char> _held;            // end event in _unheld
+
+        m2_indexed_heap _pending_ends;      // end events proposed, waiting or disabled
+        std::vector<int> _unheld;           // pending end events that may be proposed or waiting
+        int _proposed_begins;
+        int _stopped_begins;                // begin events waiting or disabled
+
+        // events changed since the last schedule() and since the last post_schedule()
+        m2_worklist _changed_begins, _changed_ends;
+        m2_worklist _iteration_begins, _iteration_ends;
+
+        std::vector<int> _min_ends;
+        std::vector<int> _post_begins, _post_ends;
+        bool _status_changed;
+
+        void init()
         {
             type = 1;
             _current_time = 0;
-            total_requests = _total_requests; 
+            current_next_time = -1;
+            existDisabled = false;
+            _proposed_begins = 0;
+            _stopped_begins = 0;
+            _indexed = 0;
         }
 
-        m2_logical_time_scheduler(const char* name, int _total_requests) 
-            : m2_scheduler(name)
+        // pair the end event j with its begin event, or queue it until the
+        // begin event is added
+        void pair_end(int j)
         {
-            type = 1;
-            _current_time = 0;
+            m2_event* end = _ends[j];
+            std::string key;
+            if (end->get_partner() != NULL)
+            {
+                std::map<m2_event *, int>::iterator it = _begin_index.find(end->get_partner());
+                if (it != _begin_index.end())
+                    _end_partner[j] = it->second;
+                else
+                    _unpaired_by_partner.insert(std::make_pair(end->get_partner(), j));
+            }
+            else if (request_key(end, key))
+            {
+                std::map<std::string, int>::iterator it = _begin_request.find(key);
+                if (it != _begin_request.end())
+                    _end_partner[j] = it->second;
+                else
+                    _unpaired_by_request.insert(std::make_pair(key, j));
+            }
+        }
+
+        // pair the queued end events with the new begin event j
+        void pair_begin(int j)
+        {
+            m2_event* begin = _begins[j];
+            _begin_index[begin] = j;
+
+            std::pair<std::multimap<m2_event *, int>::iterator, std::multimap<m2_event *, int>::iterator> by_partner;
+            by_partner = _unpaired_by_partner.equal_range(begin);
+            for (std::multimap<m2_event *, int>::iterator it = by_partner.first; it != by_partner.second; it++)
+            {
+                _end_partner[it->second] = j;
+            }
+            _unpaired_by_partner.erase(by_partner.first, by_partner.second);
+
+            std::string key;
+            if (request_key(begin, key) && (_begin_request.find(key) == _begin_request.end()))
+            {
+                _begin_request[key] = j;
+                std::pair<std::multimap<std::string, int>::iterator, std::multimap<std::string, int>::iterator> by_request;
+                by_request = _unpaired_by_request.equal_range(key);
+                for (std::multimap<std::string, int>::iterator it = by_request.first; it != by_request.second; it++)
+                {
+                    _end_partner[it->second] = j;
+                }
+                _unpaired_by_request.erase(by_request.first, by_request.second);
+            }
+        }
+
+        // sort the events added since the last call into the begin and end
+        // arrays, pairing each with the events already indexed
+        void index_events()
+        {
+            for (; _indexed < _event_list.size(); _indexed++)
+            {
+                m2_event* e = _event_list[_indexed];
+                M2_Event_Types t = event_type(e);
+                if (t == M2_EVENT_BEGIN)
+                {
+                    int j = _begins.size();
+                    _begins.push_back(e);
+                    _begin_time.push_back(0);
+                    _begin_state.push_back(0);
+                    _changed_begins.resize(j + 1);
+                    _iteration_begins.resize(j + 1);
+                    e->add_watcher(&_changed_begins, j);
+                    e->add_watcher(&_iteration_begins, j);
+                    _changed_begins.push(j);
+                    _iteration_begins.push(j);
+                    pair_begin(j);
+                }
+                else if (t == M2_EVENT_END)
+                {
+                    int j = _ends.size();
+                    _ends.push_back(e);
+                    _end_partner.push_back(-1);
+                    _held.push_back(0);
+                    _pending_ends.resize(j + 1);
+                    _changed_ends.resize(j + 1);
+                    _iteration_ends.resize(j + 1);
+                    e->add_watcher(&_changed_ends, j);
+                    e->add_watcher(&_iteration_ends, j);
+                    _changed_ends.push(j);
+                    _iteration_ends.push(j);
+                    pair_end(j);
+                }
+            }
+        }
+
+        // bring the counters and the heap up to date with the changed events
+        void update_changed()
+        {
+            while (!_changed_begins.empty())
+            {
+                int j = _changed_begins.pop();
+                _changed_begins.done(j);
+                char s = _begins[j]->get_status();
+                char state = (s == (char)M2_EVENT_PROPOSED) ? 1 : 
+                    (((s == (char)M2_EVENT_WAITING) || (s == (char)M2_EVENT_DISABLED)) ? 2 : 0);
+                _proposed_begins += (state == 1) - (_begin_state[j] == 1);
+                _stopped_begins += (state == 2) - (_begin_state[j] == 2);
+                _begin_state[j] = state;
+                // proposed begin event - will be executed immediately
+                // record current time
+                if (state == 1)
+                {
+                    _begin_time[j] = _current_time;
+                    M2_DEBUG3("Begin event time " << _begins[j]->get_owner().name() << " " << _current_time); 
+                }
+            }
+
+            while (!_changed_ends.empty())
+            {
+                int j = _changed_ends.pop();
+                _changed_ends.done(j);
+                char s = _ends[j]->get_status();
+                bool pending = (s == (char)M2_EVENT_PROPOSED) || (s == (char)M2_EVENT_WAITING) 
+                    || (s == (char)M2_EVENT_DISABLED);
+                if (pending)
+                {
+                    double begin_time = (_end_partner[j] >= 0) ? _begin_time[_end_partner[j]] : 0;
+                    _pending_ends.push(j, begin_time + _ends[j]->tag);
+                    if ((s != (char)M2_EVENT_DISABLED) && !_held[j])
+                    {
+                        _held[j] = 1;
+                        _unheld.push_back(j);
+                    }
+                }
+                else
+                {
+                    _pending_ends.remove(j);
+                }
+            }
+        }
+
+        void change_status(m2_event* e, char status)
+        {
+            if (e->get_status() != status)
+            {
+                e->set_status(status);
+                _status_changed = true;
+            }
+        }
+
+        // pops all the indices of worklist into list
+        static void drain(m2_worklist& worklist, std::vector<int>& list)
+        {
+            list.clear();
+            while (!worklist.empty())
+            {
+                int j = worklist.pop();
+                worklist.done(j);
+                list.push_back(j);
+            }
+        }
+
+      public:
+
+        m2_logical_time_scheduler(int _total_requests) 
+            : m2_scheduler()
+        {
+            init();
+            total_requests = _total_requests; 
+        }
+
+        m2_logical_time_scheduler(const char* name, int _total_requests) 
+            : m2_scheduler(name)
+        {
+            init();
             total_requests = _total_requests; 
         }
 
         m2_logical_time_scheduler(const std::vector<m2_event *> event_list, int _total_requests) 
             : m2_scheduler(event_list)
         {
-            type = 1;
-            _current_time = 0;
+            init();
             total_requests = _total_requests; 
         }
 
         m2_logical_time_scheduler(const char* name, const std::vector<m2_event *> event_list, int _total_requests) 
             : m2_scheduler(name, event_list)
         {
-            type = 1;
-            _current_time = 0;
+            init();
             total_requests = _total_requests; 
         }
 
+        void set_cluster(int cluster)
+        {
+            m2_scheduler::set_cluster(cluster);
+            _changed_begins.set_cluster(cluster);
+            _changed_ends.set_cluster(cluster);
+            _iteration_begins.set_cluster(cluster);
+            _iteration_ends.set_cluster(cluster);
+        }
+
+        bool uses_watchers()
+        {
+            return true;
+        }
+
         void set_start_time(double time)
         {
             _current_time = time;
@@ -248,11 +1099,24 @@ namespace m2_core { // begin namespace m2_core
         {
             return _current_time; 
         }
+
+        // time the current iteration moves to, the current time if it does not advance
+        double get_next_time()
+        {
+            return (!existDisabled && (current_next_time != -1)) ? current_next_time : _current_time;
+        }
+
         void add_event(m2_event* e)
         {
-            _event_list.push_back(e);
+            m2_scheduler::add_event(e);
             if (std::find(_process_list.begin(), _process_list.end(), e->get_owner()) == _process_list.end())
                 _process_list.push_back(e->get_owner());
+            index_events();
+        }
+
+        void elaborate()
+        {
+            index_events();
         }
 
         void update_end_process(sc_process_handle proc)
@@ -273,140 +1137,453 @@ namespace m2_core { // begin namespace m2_core
 
         void schedule()
         {
-            std::vector<int> enable_list;
-            int current_requests = 0;
-            bool proceed = true;
+            index_events();
+            update_changed();
 
             current_next_time = -1;
+            _status_changed = false;
 
-            std::vector<char> status_list;
-            for (unsigned int i=0; i<_event_list.size(); i++)
+            // waiting begin events and pending end events are regarded as stopped
+            int current_requests = _stopped_begins + _pending_ends.size();
+            bool proceed = (_proposed_begins == 0);
+
+            assert(current_requests <= total_requests);
+
+            if (current_requests < total_requests)
+                proceed = false;
+
+            M2_DEBUG3("proceed " << proceed << " request #: " << current_requests);
+
+            if (!proceed)
             {
-                status_list.push_back((char)_event_list[i]->get_status());
+                for (unsigned k = 0; k < _unheld.size(); k++)
+                {
+                    int j = _unheld[k];
+                    char s = _ends[j]->get_status();
+                    if ((s == (char)M2_EVENT_PROPOSED) || (s == (char)M2_EVENT_WAITING))
+                        change_status(_ends[j], (char)M2_EVENT_DISABLED);
+                    _held[j] = 0;
+                }
+                _unheld.clear();
+
+                stable = !_status_changed;
+                return;
             }
 
-            for (unsigned i = 0; i < _event_list.size(); i ++)
+            // the end events completing first are enabled together, unless one of
+            // them is disabled by someone else; all the others are disabled
+            _min_ends.clear();
+            if (!_pending_ends.empty())
             {
-                M2_DEBUG3("During scheduling " << _event_list[i]->get_full_name() << " is " << _event_list[i]->string_status()); 
-                // proposed begin event - will be executed immediately
-                // record current time
-                if ((_event_list[i]->get_status() == (char)M2_EVENT_PROPOSED) && 
-                        (_event_list[i]->name()[strlen(_event_list[i]->name()) - 1] == 'b'))
+                current_next_time = _pending_ends.top_key();
+                _pending_ends.collect_min(_min_ends);
+            }
+
+            existDisabled = false;
+            for (unsigned k = 0; k < _min_ends.size(); k++)
+            {
+                if (_ends[_min_ends[k]]->get_status() == (char)M2_EVENT_DISABLED)
+                    existDisabled = true;
+            }
+
+            for (unsigned k = 0; k < _unheld.size(); k++)
+            {
+                int j = _unheld[k];
+                char s = _ends[j]->get_status();
+                if ((_pending_ends.key(j) != current_next_time) 
+                        && ((s == (char)M2_EVENT_PROPOSED) || (s == (char)M2_EVENT_WAITING)))
+                    change_status(_ends[j], (char)M2_EVENT_DISABLED);
+                _held[j] = 0;
+            }
+            _unheld.clear();
+
+            M2_DEBUG1("enable list size " << _min_ends.size());
+
+            for (unsigned k = 0; k < _min_ends.size(); k++)
+            {
+                change_status(_ends[_min_ends[k]], existDisabled ? (char)M2_EVENT_DISABLED : (char)M2_EVENT_PROPOSED);
+            }
+
+            stable = !_status_changed;
+        }
+
+        bool is_stable()
+        {
+            return stable;
+        }
+
+        void post_schedule()
+        {
+            index_events();
+            drain(_iteration_begins, _post_begins);
+            drain(_iteration_ends, _post_ends);
+
+            for (unsigned k = 0; k < _post_begins.size(); k++)
+            {
+                if (_begins[_post_begins[k]]->get_status() == (char)M2_EVENT_DISABLED)
+                    _begins[_post_begins[k]]->set_status((char)M2_EVENT_WAITING);
+            }
+            for (unsigned k = 0; k < _post_ends.size(); k++)
+            {
+                if (_ends[_post_ends[k]]->get_status() == (char)M2_EVENT_DISABLED)
+                    _ends[_post_ends[k]]->set_status((char)M2_EVENT_WAITING);
+            }
+            if (!existDisabled && (current_next_time != -1))
+            {
+                _current_time = current_next_time;
+                M2_LOG(M2_LOG_SCHED, M2_LOG_INFO, "current global time %f", _current_time);
+            }
+            for (unsigned k = 0; k < _post_begins.size(); k++)
+            {
+                if (_begins[_post_begins[k]]->get_status() == (char)M2_EVENT_PROPOSED)
+                    _begins[_post_begins[k]]->tag = _current_time;
+            }
+            for (unsigned k = 0; k < _post_ends.size(); k++)
+            {
+                if (_ends[_post_ends[k]]->get_status() == (char)M2_EVENT_PROPOSED)
+                    _ends[_post_ends[k]]->tag = _current_time;
+            }
+
+            // schedule() is not called in iterations where none of the events changed
+            current_next_time = -1;
+        }
+
+    };
+
+    //**************************************************************
+    // MetroII shared resource scheduler 
+    //**************************************************************    
+    // Base of the schedulers arbitrating a shared resource. Every begin event
+    // and its end event form a request slot. The begin event requests the
+    // resource and the end event releases it; between the two the slot is
+    // started. Events that are neither begin nor end events are single-event
+    // slots that never hold the resource.
+    //
+    // Status changes reach the scheduler through event watchers. The derived
+    // scheduler is told when the requesting event of a slot (its begin event,
+    // or its end event once started) becomes proposed or waiting and when it
+    // stops being so, and picks the slot to grant with select(). Every other
+    // proposed or waiting event is disabled, and disabled events go back to
+    // waiting after the iteration.
+    class m2_resource_scheduler : public m2_scheduler
+    {
+      protected:
+        int total_requests;
+        unsigned _indexed;                  // events of _event_list already put in slots
+
+        std::vector<m2_event *> _slot_begin;
+        std::vector<m2_event *> _slot_end;
+        std::vector<int> _slot_process;     // process_table index of the owner
+        std::vector<char> _dead;            // owner process has ended
+        std::vector<char> _started;         // begin enabled, end not yet
+        std::vector<char> _requesting;      // requesting event proposed or waiting
+        std::vector<char> _held;            // slot in _unheld
+        std::map<m2_event *, int> _slot_of;
+        std::vector<std::vector<int> > _process_slots;  // by process_table index
+
+        // slots with only a begin (or only an end) event, by request key
+        std::multimap<std::string, int> _open_begins, _open_ends;
+
+        int _granted;                       // slot granted by the last schedule(), -1 if none
+        std::vector<int> _unheld;           // slots that may have proposed or waiting events
+
+        m2_worklist _changed;               // slots changed since the last schedule()
+        m2_worklist _changed_iteration;     // slots changed since the last post_schedule()
+        std::vector<int> _post_slots;
+        bool _status_changed;
+
+        // the event requesting the resource and the one releasing it
+        m2_event* request_event(int slot)
+        {
+            if (_slot_begin[slot] == NULL)
+                return _slot_end[slot];
+            return _started[slot] ? _slot_end[slot] : _slot_begin[slot];
+        }
+
+        m2_event* release_event(int slot)
+        {
+            return (_slot_begin[slot] != NULL) ? _slot_end[slot] : NULL;
+        }
+
+        static bool requesting(m2_event* e)
+        {
+            char s = e->get_status();
+            return (s == (char)M2_EVENT_PROPOSED) || (s == (char)M2_EVENT_WAITING);
+        }
+
+        // called for a new slot, before any of the hooks below
+        virtual void add_slot(int slot) {}
+
+        // the requesting event of the slot became (or stopped being)
+        // proposed or waiting
+        virtual void set_ready(int slot, bool ready) = 0;
+
+        // slot to grant among the ready ones, -1 for none
+        virtual int select() = 0;
+
+        // the requesting event of the slot was enabled; begin is false when
+        // it was the end event of a started slot
+        virtual void granted(int slot, bool begin) {}
+
+        // the owner of the slot ended
+        virtual void removed(int slot) {}
+
+        int new_slot(m2_event* begin, m2_event* end)
+        {
+            int slot = _slot_begin.size();
+            _slot_begin.push_back(begin);
+            _slot_end.push_back(end);
+            _slot_process.push_back(process_table.index_of(((begin != NULL) ? begin : end)->get_owner()));
+            _dead.push_back(0);
+            _started.push_back(0);
+            _requesting.push_back(0);
+            _held.push_back(0);
+            _changed.resize(slot + 1);
+            _changed_iteration.resize(slot + 1);
+            add_slot(slot);
+            return slot;
+        }
+
+        void add_to_slot(m2_event* e, int slot)
+        {
+            _slot_of[e] = slot;
+            e->add_watcher(&_changed, slot);
+            e->add_watcher(&_changed_iteration, slot);
+            _changed.push(slot);
+            _changed_iteration.push(slot);
+
+            unsigned p = _slot_process[slot];
+            if (_process_slots.size() <= p)
+                _process_slots.resize(p + 1);
+            if (std::find(_process_slots[p].begin(), _process_slots[p].end(), slot) == _process_slots[p].end())
+                _process_slots[p].push_back(slot);
+        }
+
+        // first slot open under key, -1 if none; the slot is removed from the map
+        static int take_open(std::multimap<std::string, int>& open, const std::string& key)
+        {
+            std::multimap<std::string, int>::iterator it = open.find(key);
+            if (it == open.end())
+                return -1;
+            int slot = it->second;
+            open.erase(it);
+            return slot;
+        }
+
+        static void remove_open(std::multimap<std::string, int>& open, m2_event* e, int slot)
+        {
+            std::string key;
+            if (!request_key(e, key))
+                return;
+            std::pair<std::multimap<std::string, int>::iterator, std::multimap<std::string, int>::iterator> range;
+            range = open.equal_range(key);
+            for (std::multimap<std::string, int>::iterator it = range.first; it != range.second; it++)
+            {
+                if (it->second == slot)
                 {
-                    _beg_time_table[_event_list[i]] = _current_time;
-                    M2_DEBUG3("Begin event time " << _event_list[i]->get_owner().name() << " " << _current_time); 
-                    proceed = false;
+                    open.erase(it);
+                    return;
                 }
-                // waiting begin event (might wait for constraint or resource)
-                // regarded as stopped
-                if (((_event_list[i]->get_status() == (char)M2_EVENT_WAITING)
-                            || (_event_list[i]->get_status() == (char)M2_EVENT_DISABLED)) 
-                        && (_event_list[i]->name()[strlen(_event_list[i]->name()) - 1] == 'b'))
+            }
+        }
+
+        // slot waiting for e as its other half, -1 if none
+        int find_open_slot(m2_event* e, M2_Event_Types t)
+        {
+            std::string key;
+            if (e->get_partner() != NULL)
+            {
+                std::map<m2_event *, int>::iterator it = _slot_of.find(e->get_partner());
+                if (it == _slot_of.end())
+                    return -1;
+                int k = it->second;
+                if ((t == M2_EVENT_END) && (_slot_begin[k] == e->get_partner()) && (_slot_end[k] == NULL))
                 {
-                    current_requests ++;
+                    remove_open(_open_begins, _slot_begin[k], k);
+                    return k;
                 }
-                // end event, either just proposed time or was waiting on constraints or time
-                // both regarded as stopped
-                if (((_event_list[i]->get_status() == (char)M2_EVENT_PROPOSED) 
-                            || (_event_list[i]->get_status() == (char)M2_EVENT_WAITING)
-                            || (_event_list[i]->get_status() == (char)M2_EVENT_DISABLED)) 
-                        && (_event_list[i]->name()[strlen(_event_list[i]->name()) - 1] == 'e'))
+                if ((t == M2_EVENT_BEGIN) && (_slot_end[k] == e->get_partner()) && (_slot_begin[k] == NULL))
                 {
-                    current_requests ++;
+                    remove_open(_open_ends, _slot_end[k], k);
+                    return k;
                 }
+                return -1;
             }
+            if (!request_key(e, key))
+                return -1;
+            return take_open((t == M2_EVENT_END) ? _open_begins : _open_ends, key);
+        }
 
-            assert(current_requests <= total_requests);
-
-            if (current_requests < total_requests)
-                proceed = false;
-
-            M2_DEBUG3("proceed " << proceed << " request #: " << current_requests);// << " beg #: " << tmp_request_count);
-
-            if (!proceed)
+        // put the events added since the last call in slots, pairing each
+        // with an open slot through the maps
+        void index_events()
+        {
+            for (; _indexed < _event_list.size(); _indexed++)
             {
-                for (unsigned i = 0; i < _event_list.size(); i ++)
+                m2_event* e = _event_list[_indexed];
+                M2_Event_Types t = event_type(e);
+                int slot = (t != M2_EVENT_GENERIC) ? find_open_slot(e, t) : -1;
+
+                if (slot >= 0)
                 {
-                    if (((_event_list[i]->get_status() == (char)M2_EVENT_PROPOSED) 
-                                || (_event_list[i]->get_status() == (char)M2_EVENT_WAITING)) 
-                            && (_event_list[i]->name()[strlen(_event_list[i]->name()) - 1] == 'e'))
-                        _event_list[i]->set_status((char)M2_EVENT_DISABLED);
+                    if (t == M2_EVENT_END)
+                        _slot_end[slot] = e;
+                    else
+                        _slot_begin[slot] = e;
                 }
-
-                stable = true;
-                for (unsigned i = 0; i < _event_list.size(); i ++)
+                else
                 {
-                    if (_event_list[i]->get_status() != status_list[i])
-                    {
-                        stable = false;
-                        break;
-                    }
+                    slot = (t == M2_EVENT_END) ? new_slot(NULL, e) : new_slot(e, NULL);
+                    std::string key;
+                    if ((t != M2_EVENT_GENERIC) && request_key(e, key))
+                        ((t == M2_EVENT_END) ? _open_ends : _open_begins).insert(std::make_pair(key, slot));
                 }
+                add_to_slot(e, slot);
+            }
+        }
 
-                return;
+        void change_status(m2_event* e, char status)
+        {
+            if (e->get_status() != status)
+            {
+                e->set_status(status);
+                _status_changed = true;
             }
+        }
+
+        void init()
+        {
+            type = 2;
+            _indexed = 0;
+            _granted = -1;
+        }
+
+      public:
+        m2_resource_scheduler()
+            : m2_scheduler()
+        {
+            init();
+        }
+
+        m2_resource_scheduler(const char* name)
+            : m2_scheduler(name)
+        {
+            init();
+        }
+
+        m2_resource_scheduler(const std::vector<m2_event *> event_list)
+            : m2_scheduler(event_list)
+        {
+            init();
+        }
+
+        m2_resource_scheduler(const char* name, const std::vector<m2_event *> event_list)
+            : m2_scheduler(name, event_list)
+        {
+            init();
+        }
+
+        void add_event(m2_event* e)
+        {
+            m2_scheduler::add_event(e);
+            index_events();
+        }
+
+        void elaborate()
+        {
+            index_events();
+        }
 
-            for (unsigned i = 0; i < _event_list.size(); i ++)
+        void set_cluster(int cluster)
+        {
+            m2_scheduler::set_cluster(cluster);
+            _changed.set_cluster(cluster);
+            _changed_iteration.set_cluster(cluster);
+        }
+
+        bool uses_watchers()
+        {
+            return true;
+        }
+
+        // the slots of the process are dropped, in time proportional to their number
+        void update_end_process(sc_process_handle proc)
+        {
+            index_events();
+            unsigned p = process_table.index_of(proc);
+            if ((p >= _process_slots.size()) || _process_slots[p].empty())
+                return;
+
+            M2_DEBUG3("dropping " << _process_slots[p].size() << " slots of ended process");
+            for (unsigned k = 0; k < _process_slots[p].size(); k++)
             {
-                if (((_event_list[i]->get_status() == (char)M2_EVENT_PROPOSED) 
-                            || (_event_list[i]->get_status() == (char)M2_EVENT_WAITING)
-                            || (_event_list[i]->get_status() == (char)M2_EVENT_DISABLED)) 
-                        && (_event_list[i]->name()[strlen(_event_list[i]->name()) - 1] == 'e'))
+                int slot = _process_slots[p][k];
+                if (_requesting[slot])
                 {
-                    if (_event_list[i]->get_status() == (char)M2_EVENT_PROPOSED)
-                        _event_list[i]->set_status((char)M2_EVENT_WAITING);
-
-                    double proposed_time = _beg_time_table[_event_list[i]] + _event_list[i]->tag;   
-                    if (proposed_time <= current_next_time || current_next_time == -1)
-                        current_next_time = proposed_time;
+                    _requesting[slot] = 0;
+                    set_ready(slot, false);
                 }
+                removed(slot);
+                _dead[slot] = 1;
+                _started[slot] = 0;
             }
+            _process_slots[p].clear();
+            decrement_total_requests();
+        }
 
-            existDisabled = false;
-            for (unsigned i = 0; i < _event_list.size(); i ++)
+        void decrement_total_requests()
+        {
+            total_requests --;
+        }
+
+        void schedule()
+        {
+            index_events();
+
+            while (!_changed.empty())
             {
-                if (((_event_list[i]->get_status() == (char)M2_EVENT_WAITING)
-                            || (_event_list[i]->get_status() == (char)M2_EVENT_DISABLED))
-                        && (_event_list[i]->name()[strlen(_event_list[i]->name()) - 1] == 'e'))
+                int slot = _changed.pop();
+                _changed.done(slot);
+                if (_dead[slot])
+                    continue;
+                bool ready = requesting(request_event(slot));
+                if (ready != (bool)_requesting[slot])
                 {
-                    double proposed_time = _beg_time_table[_event_list[i]] + _event_list[i]->tag;
-                    M2_DEBUG3("Proposed_time scheduling " << proposed_time); 
-                    if (proposed_time == current_next_time){
-                        enable_list.push_back(i);
-                        if (_event_list[i]->get_status() == (char)M2_EVENT_DISABLED)
-                        {
-                            existDisabled = true;
-                        }
-                    }
-                    else {
-                        _event_list[i]->set_status((char)M2_EVENT_DISABLED);
-                    }       		
+                    _requesting[slot] = ready;
+                    set_ready(slot, ready);
+                }
+                if (!_held[slot] && (requesting(_slot_begin[slot] != NULL ? _slot_begin[slot] : _slot_end[slot]) 
+                            || ((release_event(slot) != NULL) && requesting(release_event(slot)))))
+                {
+                    _held[slot] = 1;
+                    _unheld.push_back(slot);
                 }
             }
 
-            M2_DEBUG1("enable list size " << enable_list.size());
+            _granted = select();
+            m2_event* grant = (_granted >= 0) ? request_event(_granted) : NULL;
+            M2_DEBUG1(_name << " granted slot: " << _granted);
 
-            if (enable_list.size() != 0)
+            _status_changed = false;
+            for (unsigned k = 0; k < _unheld.size(); k++)
             {
-                for (unsigned i=0; i<enable_list.size(); i++)
+                int slot = _unheld[k];
+                m2_event* events[2] = { _slot_begin[slot], _slot_end[slot] };
+                for (int j = 0; j < 2; j++)
                 {
-                    if (existDisabled)
-                        _event_list[enable_list[i]]->set_status((char)M2_EVENT_DISABLED);
-                    else 
-                        _event_list[enable_list[i]]->set_status((char)M2_EVENT_PROPOSED);
+                    if ((events[j] != NULL) && (events[j] != grant) && requesting(events[j]))
+                        change_status(events[j], (char)M2_EVENT_DISABLED);
                 }
-                enable_list.clear();
+                _held[slot] = 0;
             }
+            _unheld.clear();
 
-            stable = true;
-            for (unsigned i = 0; i < _event_list.size(); i ++)
+            if (grant != NULL)
             {
-                if (_event_list[i]->get_status() != status_list[i])
-                {
-                    stable = false;
-                    break;
-                }
+                change_status(grant, (char)M2_EVENT_PROPOSED);
             }
+
+            stable = !_status_changed;
         }
 
         bool is_stable()
@@ -416,192 +1593,531 @@ namespace m2_core { // begin namespace m2_core
 
         void post_schedule()
         {
-            for (unsigned int i =0 ; i < _event_list.size(); i++)
+            index_events();
+
+            if ((_granted >= 0) && !_dead[_granted] 
+                    && (request_event(_granted)->get_status() == (char)M2_EVENT_PROPOSED))
             {
-                if (_event_list[i]->get_status() == (char)M2_EVENT_DISABLED)
+                bool begin = !_started[_granted];
+                M2_DEBUG1((begin ? "enable" : "release") << " slot " << _granted << " in " << _name);
+                granted(_granted, begin);
+                if (release_event(_granted) != NULL)
                 {
-                    _event_list[i]->set_status((char)M2_EVENT_WAITING);
+                    _started[_granted] = begin;
+                    // the requesting event changed
+                    _changed.push(_granted);
                 }
             }
-            if (!existDisabled && (current_next_time != -1))
+            _granted = -1;
+
+            _post_slots.clear();
+            while (!_changed_iteration.empty())
             {
-                _current_time = current_next_time;
-                printf("current global time %f\n", _current_time);
+                int slot = _changed_iteration.pop();
+                _changed_iteration.done(slot);
+                _post_slots.push_back(slot);
             }
-            for (unsigned int i=0; i < _event_list.size(); i++)
+            for (unsigned k = 0; k < _post_slots.size(); k++)
             {
-                if (_event_list[i]->get_status() == (char)M2_EVENT_PROPOSED)
+                int slot = _post_slots[k];
+                m2_event* events[2] = { _slot_begin[slot], _slot_end[slot] };
+                for (int j = 0; j < 2; j++)
                 {
-                    _event_list[i]->tag = _current_time;
+                    if ((events[j] != NULL) && (events[j]->get_status() == (char)M2_EVENT_DISABLED))
+                        events[j]->set_status((char)M2_EVENT_WAITING);
                 }
             }
         }
-
     };
 
     //**************************************************************
     // MetroII round-robin shared resource scheduler 
     //**************************************************************    
-    class m2_round_robin_scheduler : public m2_scheduler
+    // Once a slot is started only its end event can be enabled, then the
+    // resource goes to the next requesting slot after it in cyclic order.
+    // Requesting slots are kept in a bit set, so a grant skips the slots that
+    // are not requesting.
+    class m2_round_robin_scheduler : public m2_resource_scheduler
     {
       private:
-        int total_requests;
-        unsigned int current_index;
-        std::vector<sc_process_handle> _process_list;
+        m2_bitset _ready;
+        int _lock;                          // started slot, -1 if the resource is free
+        int _last;                          // last slot granted
+
+        void init()
+        {
+            _lock = -1;
+            _last = -1;
+        }
+
+      protected:
+        void add_slot(int slot)
+        {
+            _ready.resize(slot + 1);
+        }
+
+        void set_ready(int slot, bool ready)
+        {
+            _ready.assign(slot, ready);
+        }
+
+        int select()
+        {
+            if (_lock >= 0)
+                return _ready.test(_lock) ? _lock : -1;
+            return _ready.find_next_cyclic(_last + 1);
+        }
+
+        void granted(int slot, bool begin)
+        {
+            if (!begin)
+            {
+                _lock = -1;
+                return;
+            }
+            _last = slot;
+            if (release_event(slot) != NULL)
+                _lock = slot;
+        }
+
+        void removed(int slot)
+        {
+            if (_lock == slot)
+                _lock = -1;
+        }
 
       public:
         m2_round_robin_scheduler()
-            : m2_scheduler()
+            : m2_resource_scheduler()
         {
-            type = 2;
-            current_index = 0;
+            init();
             _name = "unknown";
         }
 
         m2_round_robin_scheduler(const char* name)
-            : m2_scheduler(name)
+            : m2_resource_scheduler(name)
         {
-            type = 2;
-            current_index = 0;
+            init();
             _name = name; 
         }
 
         m2_round_robin_scheduler(const std::vector<m2_event *> event_list)
-            : m2_scheduler(event_list)
+            : m2_resource_scheduler(event_list)
         {
-            type = 2;
-            current_index = 0;
+            init();
             _name = "unknown"; 
-            _event_list= event_list;
         }
 
         m2_round_robin_scheduler(const char* name, const std::vector<m2_event *> event_list)
-            : m2_scheduler(name, event_list)
+            : m2_resource_scheduler(name, event_list)
         {
-            type = 2;
-            current_index = 0;
+            init();
             _name = name; 
-            _event_list= event_list;
         }
+    };
 
-        void add_event(m2_event* e)
+    //**************************************************************
+    // MetroII fixed-priority shared resource scheduler 
+    //**************************************************************    
+    // The resource goes to the requesting slot with the highest priority,
+    // 0 being the highest (negative priorities are rejected). Slots of the
+    // same priority are served round-robin.
+    // Priorities are set per event (the begin or the end event of a slot) or
+    // per process, the other slots get the default priority (0 unless set
+    // with set_default_priority).
+    //
+    // Ready slots are kept in one bit set per priority level, and the levels
+    // with a ready slot in another bit set, so a decision is a find-first-set
+    // over the levels and a find-next-set within the level.
+    //
+    // Without preemption a started slot holds the resource until its end
+    // event is enabled. With preemption a begin event of a higher priority
+    // than the running slot is granted at once; the preempted slots resume,
+    // innermost first, when the slots preempting them have ended. The
+    // logical time scheduler does not extend the completion time of a
+    // preempted slot, so preemption is meant for models without it.
+    class m2_priority_scheduler : public m2_resource_scheduler
+    {
+      private:
+        bool _preemptive;
+        int _default_priority;
+        std::vector<int> _priority;             // by slot
+        std::map<m2_event *, int> _event_priority;
+        std::vector<int> _process_priority;     // by process_table index, -1 if not set
+
+        m2_bitset _levels;                      // levels with a ready slot
+        std::vector<m2_bitset> _level_slots;    // ready slots of each level
+        std::vector<int> _level_count;
+        std::vector<int> _level_last;           // last slot granted in each level
+        std::vector<int> _running;              // started slots, the running one last
+
+        void init()
         {
-            _event_list.push_back(e);
-            if (std::find(_process_list.begin(), _process_list.end(), e->get_owner()) == _process_list.end())
-                _process_list.push_back(e->get_owner());
+            _preemptive = false;
+            _default_priority = 0;
         }
 
-        void update_end_process(sc_process_handle proc)
+        int priority_of(int slot)
         {
-            M2_DEBUG3("start updating end process");
-            M2_DEBUG3("event list size:" << _event_list.size() <<", current index: " << current_index);
-            std::vector<sc_process_handle>::iterator it;
-            it = std::find(_process_list.begin(), _process_list.end(), proc);
-            if (it != _process_list.end())
+            m2_event* events[2] = { _slot_begin[slot], _slot_end[slot] };
+            for (int j = 0; j < 2; j++)
             {
-                unsigned int i = 0;
-                while (i < _event_list.size())
-                {
-                    if (_event_list[i]->get_owner() == proc)
-                    {
-                        if (current_index > i)
-                        {
-                            current_index --;
-                        }
-                        _event_list.erase(_event_list.begin() + i);
-                    }
-                    else {
-                        i ++;
-                    }
-                }
-                if (current_index >= _event_list.size())
-                {
-                    assert(current_index == _event_list.size());
-                    current_index = 0;
-                }
-                _process_list.erase(it);
-                decrement_total_requests();
+                if (events[j] == NULL)
+                    continue;
+                std::map<m2_event *, int>::iterator it = _event_priority.find(events[j]);
+                if (it != _event_priority.end())
+                    return it->second;
             }
-            M2_DEBUG3("finish updating end process");
-            M2_DEBUG3("event list size:" << _event_list.size() <<", current index: " << current_index);
+            unsigned p = _slot_process[slot];
+            if ((p < _process_priority.size()) && (_process_priority[p] >= 0))
+                return _process_priority[p];
+            return _default_priority;
         }
 
-        void decrement_total_requests()
+        void add_level(int level)
         {
-            total_requests --;
+            if ((int)_level_slots.size() <= level)
+            {
+                _level_slots.resize(level + 1);
+                _level_count.resize(level + 1, 0);
+                _level_last.resize(level + 1, -1);
+                _levels.resize(level + 1);
+            }
+            if (_level_slots[level].size() < (int)_priority.size())
+                _level_slots[level].resize(_priority.size());
         }
 
-        void schedule()
+        void set_slot_priority(int slot, int priority)
         {
-            M2_DEBUG3("before round robin scheduling: \n");
-            for (unsigned int i=0; i<_event_list.size(); i++)
+            // not computed yet
+            if ((_priority[slot] < 0) || (_priority[slot] == priority))
+                return;
+            touch();
+            bool ready = _requesting[slot] && !_dead[slot];
+            if (ready)
+                set_ready(slot, false);
+            _priority[slot] = priority;
+            if (ready)
+                set_ready(slot, true);
+        }
+
+      protected:
+        void add_slot(int slot)
+        {
+            // computed when the slot is first ready, once both events are known
+            _priority.push_back(-1);
+        }
+
+        void set_ready(int slot, bool ready)
+        {
+            if (ready && (_priority[slot] < 0))
             {
-                M2_DEBUG3("event: "<<_event_list[i]->get_full_name()<<" status: "<<_event_list[i]->string_status());
+                _priority[slot] = priority_of(slot);
             }
+            int level = _priority[slot];
+            add_level(level);
+            if (ready == _level_slots[level].test(slot))
+                return;
+            _level_slots[level].assign(slot, ready);
+            _level_count[level] += ready ? 1 : -1;
+            _levels.assign(level, _level_count[level] > 0);
+        }
 
-            std::vector<char> status_list;
-            for (unsigned int i=0; i<_event_list.size(); i++)
+        int select()
+        {
+            int level = _levels.find_next(0);
+            if (!_running.empty())
             {
-                status_list.push_back((char)_event_list[i]->get_status());
+                int top = _running.back();
+                if (!_preemptive || (level < 0) || (_priority[top] <= level))
+                    return _requesting[top] ? top : -1;
             }
+            if (level < 0)
+                return -1;
+            return _level_slots[level].find_next_cyclic(_level_last[level] + 1);
+        }
 
-            M2_DEBUG1("current index: " << current_index);
-            for (unsigned int i=0; i<_event_list.size(); i++)
+        void granted(int slot, bool begin)
+        {
+            if (!begin)
             {
-                if (((_event_list[i]->get_status() == (char)M2_EVENT_PROPOSED)
-                            || (_event_list[i]->get_status() == (char)M2_EVENT_WAITING))
-                        && (i != current_index))
-                {
-                    _event_list[i]->set_status((char)M2_EVENT_DISABLED);
-                }
+                _running.erase(std::remove(_running.begin(), _running.end(), slot), _running.end());
+                return;
             }
-            if ((_event_list[current_index]->get_status() == (char)M2_EVENT_PROPOSED)
-                    || (_event_list[current_index]->get_status() == (char)M2_EVENT_WAITING))
+            _level_last[_priority[slot]] = slot;
+            if (release_event(slot) != NULL)
+                _running.push_back(slot);
+        }
+
+        void removed(int slot)
+        {
+            _running.erase(std::remove(_running.begin(), _running.end(), slot), _running.end());
+        }
+
+      public:
+        m2_priority_scheduler()
+            : m2_resource_scheduler()
+        {
+            init();
+            _name = "unknown";
+        }
+
+        m2_priority_scheduler(const char* name)
+            : m2_resource_scheduler(name)
+        {
+            init();
+            _name = name; 
+        }
+
+        m2_priority_scheduler(const std::vector<m2_event *> event_list)
+            : m2_resource_scheduler(event_list)
+        {
+            init();
+            _name = "unknown"; 
+        }
+
+        m2_priority_scheduler(const char* name, const std::vector<m2_event *> event_list)
+            : m2_resource_scheduler(name, event_list)
+        {
+            init();
+            _name = name; 
+        }
+
+        void set_preemptive(bool preemptive)
+        {
+            _preemptive = preemptive;
+        }
+
+        bool is_preemptive()
+        {
+            return _preemptive;
+        }
+
+        // priority of the slots without an event or process priority
+        void set_default_priority(int priority)
+        {
+            if (priority < 0)
             {
-                _event_list[current_index]->set_status((char)M2_EVENT_PROPOSED);
+                SC_REPORT_ERROR(_name, "negative priority");
+                return;
+            }
+            _default_priority = priority;
+            for (unsigned slot = 0; slot < _priority.size(); slot++)
+            {
+                set_slot_priority(slot, priority_of(slot));
+            }
+        }
 
+        // priority of the slot of e (its begin or end event)
+        void set_priority(m2_event* e, int priority)
+        {
+            if (priority < 0)
+            {
+                SC_REPORT_ERROR(_name, "negative priority");
+                return;
             }
+            _event_priority[e] = priority;
+            index_events();
+            std::map<m2_event *, int>::iterator it = _slot_of.find(e);
+            if (it != _slot_of.end())
+                set_slot_priority(it->second, priority_of(it->second));
+        }
 
-            stable = true;
-            for (unsigned i = 0; i < _event_list.size(); i ++)
+        // priority of all the slots of the process
+        void set_priority(sc_process_handle proc, int priority)
+        {
+            if (priority < 0)
             {
-                if (_event_list[i]->get_status() != status_list[i])
+                SC_REPORT_ERROR(_name, "negative priority");
+                return;
+            }
+            unsigned p = process_table.index_of(proc);
+            if (_process_priority.size() <= p)
+                _process_priority.resize(p + 1, -1);
+            _process_priority[p] = priority;
+            index_events();
+            if (p < _process_slots.size())
+            {
+                for (unsigned k = 0; k < _process_slots[p].size(); k++)
                 {
-                    stable = false;
-                    break;
+                    set_slot_priority(_process_slots[p][k], priority_of(_process_slots[p][k]));
                 }
             }
+        }
+
+        int get_priority(m2_event* e)
+        {
+            index_events();
+            std::map<m2_event *, int>::iterator it = _slot_of.find(e);
+            return (it == _slot_of.end()) ? -1 : priority_of(it->second);
+        }
+    };
+
+    //**************************************************************
+    // MetroII earliest deadline first shared resource scheduler 
+    //**************************************************************    
+    // The resource goes to the requesting slot with the earliest absolute
+    // deadline; a started slot holds it until its end event is enabled.
+    // The deadline of a request is the val of its begin event when set,
+    // otherwise the relative deadline of the owner process added to the
+    // logical time at which the request was first seen. Requests without
+    // a deadline come after all the others. Ties go to the lower slot.
+    //
+    // Ready slots are kept in an indexed min-heap keyed by deadline. When a
+    // slot releases the resource after its deadline, a miss is counted for
+    // its process. Times come from the logical time scheduler given with
+    // set_clock, and are 0 without one.
+    class m2_edf_scheduler : public m2_resource_scheduler
+    {
+      private:
+        m2_logical_time_scheduler* _clock;
+        m2_indexed_heap _ready;
+        int _lock;                              // started slot, -1 if the resource is free
+        std::vector<double> _deadline;          // by slot, of the current request
+        std::vector<char> _has_deadline;        // deadline of the current request computed
+        std::vector<double> _relative_deadline; // by process_table index, negative if not set
+        std::vector<int> _misses;               // by process_table index
+        int _total_misses;
+
+        void init()
+        {
+            _clock = NULL;
+            _lock = -1;
+            _total_misses = 0;
+        }
+
+        double now()
+        {
+            return (_clock != NULL) ? _clock->get_next_time() : 0;
+        }
+
+        double deadline_of(int slot)
+        {
+            m2_event* begin = (_slot_begin[slot] != NULL) ? _slot_begin[slot] : _slot_end[slot];
+            if (begin->val != NONDET)
+                return begin->val;
+            unsigned p = _slot_process[slot];
+            if ((p < _relative_deadline.size()) && (_relative_deadline[p] >= 0))
+                return now() + _relative_deadline[p];
+            return std::numeric_limits<double>::max();
+        }
 
-            M2_DEBUG3("after round robin scheduling: \n");
-            for (unsigned int i=0; i<_event_list.size(); i++)
+        // the request of the slot is served
+        void complete(int slot)
+        {
+            _has_deadline[slot] = 0;
+            if (now() > _deadline[slot])
             {
-                M2_DEBUG3("event: "<<_event_list[i]->get_full_name()<<" status: "<<_event_list[i]->string_status());
+                unsigned p = _slot_process[slot];
+                if (_misses.size() <= p)
+                    _misses.resize(p + 1, 0);
+                _misses[p]++;
+                _total_misses++;
+                M2_DEBUG2(_name << " deadline miss of slot " << slot << " at " << now() 
+                        << ", deadline " << _deadline[slot]);
             }
         }
 
-        bool is_stable()
+      protected:
+        void add_slot(int slot)
         {
-            return stable;
+            _ready.resize(slot + 1);
+            _deadline.push_back(0);
+            _has_deadline.push_back(0);
         }
 
-        void post_schedule()
+        void set_ready(int slot, bool ready)
         {
-            if (_event_list[current_index]->get_status() == (char)M2_EVENT_PROPOSED)
+            if (!ready)
             {
-                M2_DEBUG1("enable index " << current_index <<" in rr schedule");
-                current_index ++;
-                if (current_index == _event_list.size())
-                {
-                    current_index = 0;
-                }
+                _ready.remove(slot);
+                return;
             }
-            for (unsigned int i = 0; i<_event_list.size(); i++)
+            if (!_has_deadline[slot])
             {
-                if (_event_list[i]->get_status() == (char)M2_EVENT_DISABLED)
-                {
-                    _event_list[i]->set_status((char)M2_EVENT_WAITING);
-                }
+                _deadline[slot] = deadline_of(slot);
+                _has_deadline[slot] = 1;
             }
+            _ready.push(slot, _deadline[slot]);
+        }
+
+        int select()
+        {
+            if (_lock >= 0)
+                return _requesting[_lock] ? _lock : -1;
+            return _ready.empty() ? -1 : _ready.top();
+        }
+
+        void granted(int slot, bool begin)
+        {
+            if (begin && (release_event(slot) != NULL))
+            {
+                _lock = slot;
+                return;
+            }
+            _lock = -1;
+            complete(slot);
+        }
+
+        void removed(int slot)
+        {
+            if (_lock == slot)
+                _lock = -1;
+            _has_deadline[slot] = 0;
+        }
+
+      public:
+        m2_edf_scheduler()
+            : m2_resource_scheduler()
+        {
+            init();
+            _name = "unknown";
+        }
+
+        m2_edf_scheduler(const char* name)
+            : m2_resource_scheduler(name)
+        {
+            init();
+            _name = name; 
+        }
+
+        m2_edf_scheduler(const std::vector<m2_event *> event_list)
+            : m2_resource_scheduler(event_list)
+        {
+            init();
+            _name = "unknown"; 
+        }
+
+        m2_edf_scheduler(const char* name, const std::vector<m2_event *> event_list)
+            : m2_resource_scheduler(name, event_list)
+        {
+            init();
+            _name = name; 
+        }
+
+        void set_clock(m2_logical_time_scheduler* clock)
+        {
+            _clock = clock;
+        }
+
+        // deadline of the requests of the process, relative to their arrival
+        void set_deadline(sc_process_handle proc, double relative_deadline)
+        {
+            unsigned p = process_table.index_of(proc);
+            if (_relative_deadline.size() <= p)
+                _relative_deadline.resize(p + 1, -1);
+            _relative_deadline[p] = relative_deadline;
+        }
+
+        int get_misses(sc_process_handle proc)
+        {
+            unsigned p = process_table.index_of(proc);
+            return (p < _misses.size()) ? _misses[p] : 0;
+        }
+
+        int get_total_misses()
+        {
+            return _total_misses;
         }
     };
 
@@ -11,6 +11,7 @@
 #include <cstring>
 #include <algorithm>
 #include <deque>
+#include <utility>
 
 #define SWITCH_PHASES (1)
 
@@ -54,7 +55,360 @@ namespace m2_core { //begin namespace m2_core
         }
     } ltstrn;
 
+    //******************************************************************************
+    // Worklist of integer indices, an index is queued at most once
+    //******************************************************************************
+    class m2_worklist
+    {
+      private:
+        std::vector<int> _items;
+        std::vector<char> _queued;
+        unsigned _head;
+        int _cluster;   // phase 3 cluster of the owner, -1 if none
+
+      public:
+        m2_worklist()
+        {
+            _head = 0;
+            _cluster = -1;
+        }
+
+        // pushes made by threads running other clusters are deferred
+        // (see m2_deferred_changes)
+        void set_cluster(int cluster)
+        {
+            _cluster = cluster;
+        }
+
+        int get_cluster()
+        {
+            return _cluster;
+        }
+
+        // indices must be smaller than n
+        void resize(int n)
+        {
+            _queued.resize(n, 0);
+        }
+
+        void push(int i)
+        {
+            if (!_queued[i])
+            {
+                _queued[i] = 1;
+                _items.push_back(i);
+            }
+        }
+
+        bool empty()
+        {
+            return _head == _items.size();
+        }
+
+        // the returned index is not queued again until done() is called for it
+        int pop()
+        {
+            int i = _items[_head++];
+            if (_head == _items.size())
+            {
+                _items.clear();
+                _head = 0;
+            }
+            return i;
+        }
+
+        void done(int i)
+        {
+            _queued[i] = 0;
+        }
+    };
+
+    //******************************************************************************
+    // Union-find over integer indices, with path halving and union by size
+    //******************************************************************************
+    class m2_union_find
+    {
+      private:
+        std::vector<int> _parent;
+        std::vector<int> _size;
+
+      public:
+        // adds a new singleton set and returns its index
+        int add()
+        {
+            _parent.push_back(_parent.size());
+            _size.push_back(1);
+            return _parent.size() - 1;
+        }
+
+        int size()
+        {
+            return _parent.size();
+        }
+
+        int find(int x)
+        {
+            while (_parent[x] != x)
+            {
+                _parent[x] = _parent[_parent[x]];
+                x = _parent[x];
+            }
+            return x;
+        }
+
+        void unite(int x, int y)
+        {
+            x = find(x);
+            y = find(y);
+            if (x == y)
+                return;
+            if (_size[x] < _size[y])
+                std::swap(x, y);
+            _parent[y] = x;
+            _size[x] += _size[y];
+        }
+    };
+
+    //******************************************************************************
+    // Indexed binary min-heap of integer items in [0, n) keyed by double
+    //******************************************************************************
+    // Every item knows its position, so keys can be changed and items removed
+    // in O(log n). Equal keys are ordered by item, so the order is reproducible.
+    class m2_indexed_heap
+    {
+      private:
+        std::vector<int> _heap;     // items in heap order
+        std::vector<int> _pos;      // position of each item in _heap, -1 if absent
+        std::vector<double> _key;   // key of each item
+
+        bool less(int a, int b)
+        {
+            return (_key[a] < _key[b]) || ((_key[a] == _key[b]) && (a < b));
+        }
+
+        void place(int i, int item)
+        {
+            _heap[i] = item;
+            _pos[item] = i;
+        }
+
+        void sift_up(int i)
+        {
+            int item = _heap[i];
+            while (i > 0)
+            {
+                int parent = (i - 1) / 2;
+                if (!less(item, _heap[parent]))
+                    break;
+                place(i, _heap[parent]);
+                i = parent;
+            }
+            place(i, item);
+        }
+
+        void sift_down(int i)
+        {
+            int item = _heap[i];
+            int n = _heap.size();
+            while (true)
+            {
+                int child = 2 * i + 1;
+                if (child >= n)
+                    break;
+                if ((child + 1 < n) && less(_heap[child + 1], _heap[child]))
+                    child++;
+                if (!less(_heap[child], item))
+                    break;
+                place(i, _heap[child]);
+                i = child;
+            }
+            place(i, item);
+        }
+
+      public:
+        // items must be smaller than n
+        void resize(int n)
+        {
+            _pos.resize(n, -1);
+            _key.resize(n, 0);
+        }
+
+        int size()
+        {
+            return _heap.size();
+        }
+
+        bool empty()
+        {
+            return _heap.empty();
+        }
+
+        bool contains(int item)
+        {
+            return _pos[item] >= 0;
+        }
+
+        double key(int item)
+        {
+            return _key[item];
+        }
+
+        int top()
+        {
+            return _heap[0];
+        }
+
+        double top_key()
+        {
+            return _key[_heap[0]];
+        }
+
+        // inserts item, or changes its key if it is already in the heap
+        void push(int item, double key)
+        {
+            if (contains(item))
+            {
+                double old = _key[item];
+                _key[item] = key;
+                if (key < old)
+                    sift_up(_pos[item]);
+                else
+                    sift_down(_pos[item]);
+                return;
+            }
+            _key[item] = key;
+            _heap.push_back(item);
+            _pos[item] = _heap.size() - 1;
+            sift_up(_heap.size() - 1);
+        }
+
+        // does nothing if item is not in the heap
+        void remove(int item)
+        {
+            if (!contains(item))
+                return;
+            int i = _pos[item];
+            int last = _heap.back();
+            _heap.pop_back();
+            _pos[item] = -1;
+            if (last != item)
+            {
+                place(i, last);
+                sift_up(i);
+                sift_down(_pos[last]);
+            }
+        }
+
+        // appends to out all the items whose key equals the minimum key,
+        // visiting only those items and their children
+        void collect_min(std::vector<int>& out)
+        {
+            if (_heap.empty())
+                return;
+            double min = top_key();
+            unsigned first = out.size();
+            out.push_back(0);   // positions first, converted to items below
+            for (unsigned k = first; k < out.size(); k++)
+            {
+                int i = out[k];
+                for (int child = 2 * i + 1; (child <= 2 * i + 2) && (child < (int)_heap.size()); child++)
+                {
+                    if (_key[_heap[child]] == min)
+                        out.push_back(child);
+                }
+            }
+            for (unsigned k = first; k < out.size(); k++)
+            {
+                out[k] = _heap[out[k]];
+            }
+        }
+    };
+
+    //******************************************************************************
+    // Bit set over integer indices with find-next-set
+    //******************************************************************************
+    class m2_bitset
+    {
+      private:
+        std::vector<unsigned long long> _words;
+        int _size;
+
+      public:
+        m2_bitset()
+        {
+            _size = 0;
+        }
+
+        void resize(int n)
+        {
+            _words.resize((n + 63) / 64, 0);
+            _size = n;
+        }
+
+        int size()
+        {
+            return _size;
+        }
+
+        void set(int i)
+        {
+            _words[i >> 6] |= 1ULL << (i & 63);
+        }
+
+        void reset(int i)
+        {
+            _words[i >> 6] &= ~(1ULL << (i & 63));
+        }
+
+        void assign(int i, bool value)
+        {
+            if (value)
+                set(i);
+            else
+                reset(i);
+        }
+
+        bool test(int i)
+        {
+            return (_words[i >> 6] >> (i & 63)) & 1;
+        }
+
+        // first set index >= i, -1 if none
+        int find_next(int i)
+        {
+            if (i >= _size)
+                return -1;
+            int w = i >> 6;
+            unsigned long long bits = _words[w] & (~0ULL << (i & 63));
+            while (bits == 0)
+            {
+                if (++w == (int)_words.size())
+                    return -1;
+                bits = _words[w];
+            }
+            return (w << 6) + __builtin_ctzll(bits);
+        }
+
+        // first set index >= i, wrapping around to 0, -1 if the set is empty
+        int find_next_cyclic(int i)
+        {
+            int next = find_next(i);
+            return (next >= 0) ? next : find_next(0);
+        }
+    };
+
     class m2_event;
+    typedef std::pair<m2_worklist*, int> event_watcher_t;
+
+    // status changes made by a thread running one phase 3 cluster: the events
+    // to add to the dirty list and the notifications of worklists that do not
+    // belong to the cluster, applied by the simulation thread afterwards
+    struct m2_deferred_changes
+    {
+        int cluster;
+        std::vector<m2_event *> dirty;
+        std::vector<event_watcher_t> watchers;
+    };
     typedef std::pair<m2_event*, m2_event*> event_pair_t;
     typedef std::map<sc_process_handle, event_pair_t*, ltprochandle> thread_event_map_t;
     typedef std::map<const char*, thread_event_map_t*> func_event_map_t;
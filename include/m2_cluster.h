@@ -0,0 +1,342 @@
+// Partition of the constraints and schedulers into independent clusters,
+// whose phase 3 fixpoints run in parallel
+
+#ifndef M2_CLUSTER_H
+#define M2_CLUSTER_H
+
+#include "m2_base.h"
+#include "m2_debug.h"
+#include "m2_event.h"
+#include "m2_constraints.h"
+#include "m2_ann_sched.h"
+#include "m2_parallel.h"
+#include "m2_stats.h"
+
+namespace m2_core { // begin namespace m2_core
+
+    //******************************************************************************
+    // Cluster: constraints and schedulers sharing events
+    //******************************************************************************
+    class m2_cluster
+    {
+      private:
+        int _id;
+        m2_constraint_solver _solver;
+        std::vector<m2_scheduler *> _schedulers;
+        m2_deferred_changes _changes;
+
+      public:
+        m2_cluster(int id)
+        {
+            _id = id;
+            _solver.set_cluster(id);
+            _changes.cluster = id;
+        }
+
+        void add_constraint(m2_constraint* c)
+        {
+            _solver.addConstraint(c);
+        }
+
+        void add_scheduler(m2_scheduler* s)
+        {
+            _schedulers.push_back(s);
+            s->set_cluster(_id);
+        }
+
+        void elaborate()
+        {
+            _solver.elaborate();
+        }
+
+        // a constraint or a scheduler has to run; schedulers without
+        // watchers run again only when statuses changed outside the cluster
+        bool pending(bool external_changes)
+        {
+            if (_solver.has_work())
+                return true;
+            for (unsigned i = 0; i < _schedulers.size(); i++)
+            {
+                if (_schedulers[i]->uses_watchers() ? _schedulers[i]->touched() : external_changes)
+                    return true;
+            }
+            return false;
+        }
+
+        // the phase 3 fixpoint restricted to the cluster, on any thread
+        void fixpoint()
+        {
+            m2_event::defer_changes(&_changes);
+            bool changed = true;
+            while (changed)
+            {
+                changed = false;
+                _solver.resolve();
+                if (!_solver.is_stable())
+                    changed = true;
+                for (unsigned i = 0; i < _schedulers.size(); i++)
+                {
+                    if (!_schedulers[i]->touched())
+                        continue;
+                    _schedulers[i]->clear_touched();
+                    _schedulers[i]->schedule();
+                    if (!_schedulers[i]->is_stable())
+                        changed = true;
+                }
+            }
+            m2_event::defer_changes(NULL);
+        }
+
+        // on the simulation thread, once fixpoint() has returned
+        void apply_changes()
+        {
+            m2_event::apply_changes(_changes);
+        }
+
+        void post_resolve()
+        {
+            _solver.post_resolve();
+        }
+    };
+
+    //******************************************************************************
+    // Phase 3 on clusters
+    //******************************************************************************
+    // Events are joined when a constraint or a non-global scheduler uses them
+    // together; each resulting group of events, with its constraints and
+    // schedulers, is a cluster. A round runs the fixpoints of the clusters
+    // with pending work on the thread pool, then the global schedulers (the
+    // logical time scheduler) on the simulation thread, and rounds repeat
+    // until no cluster has work left and the global schedulers are stable.
+    //
+    // Clusters with a scheduler that does not use watchers also run again
+    // when the global schedulers changed any status (m2_event::epoch()).
+    //
+    // Status changes on a cluster thread only notify the worklists of that
+    // cluster at once; the dirty list and the other worklists (of the global
+    // schedulers) are updated between rounds.
+    class m2_cluster_set
+    {
+      private:
+        std::vector<m2_cluster *> _clusters;
+        std::vector<m2_scheduler *> _globals;
+        std::vector<m2_cluster *> _active;
+        std::atomic<unsigned> _next;
+
+        // what the partition was built from
+        m2_constraint_solver* _solver;
+        unsigned _num_constraints;
+        std::vector<m2_scheduler *> _schedulers;
+        std::vector<unsigned> _num_events;  // of _schedulers
+        m2_thread_pool _pool;
+
+      public:
+        m2_cluster_set()
+        {
+            _next = 0;
+            _solver = NULL;
+            _num_constraints = 0;
+        }
+
+        ~m2_cluster_set()
+        {
+            clear();
+        }
+
+        void clear()
+        {
+            for (unsigned i = 0; i < _clusters.size(); i++)
+            {
+                delete _clusters[i];
+            }
+            _clusters.clear();
+            _globals.clear();
+            _solver = NULL;
+            _num_constraints = 0;
+            _schedulers.clear();
+            _num_events.clear();
+        }
+
+        // constraints, schedulers or scheduler events were added since the
+        // partition was built; it cannot be rebuilt, since the events keep
+        // watching the worklists of the clusters
+        bool stale(m2_constraint_solver* solver, std::vector<m2_scheduler *>& schedulers)
+        {
+            if ((solver != _solver) || (solver->get_constraints().size() != _num_constraints)
+                    || (schedulers.size() != _schedulers.size()))
+                return true;
+            for (unsigned i = 0; i < _schedulers.size(); i++)
+            {
+                if (_schedulers[i]->get_events().size() > _num_events[i])
+                    return true;
+            }
+            return false;
+        }
+
+        int size()
+        {
+            return _clusters.size();
+        }
+
+        void set_threads(int threads)
+        {
+            _pool.resize(std::max(threads, 1));
+        }
+
+        int get_threads()
+        {
+            return _pool.size();
+        }
+
+        // returns false, and builds nothing, if a constraint does not report
+        // its events; the solver must then run as a whole
+        bool build(m2_constraint_solver* solver, std::vector<m2_scheduler *>& schedulers)
+        {
+            clear();
+            std::vector<m2_constraint *>& constraints = solver->get_constraints();
+            std::vector<std::vector<m2_event *> > constraint_events(constraints.size());
+            m2_union_find sets;
+            for (int i = 0; i < event_table.size(); i++)
+            {
+                sets.add();
+            }
+
+            for (unsigned i = 0; i < constraints.size(); i++)
+            {
+                constraints[i]->elaborate();
+                if (!constraints[i]->get_events(constraint_events[i]))
+                {
+                    M2_DEBUG1("constraint without event list, phase 3 is not partitioned");
+                    return false;
+                }
+                for (unsigned j = 1; j < constraint_events[i].size(); j++)
+                {
+                    sets.unite(constraint_events[i][0]->get_id(), constraint_events[i][j]->get_id());
+                }
+            }
+            for (unsigned i = 0; i < schedulers.size(); i++)
+            {
+                std::vector<m2_event *>& events = schedulers[i]->get_events();
+                if (schedulers[i]->is_global())
+                    continue;
+                for (unsigned j = 1; j < events.size(); j++)
+                {
+                    sets.unite(events[0]->get_id(), events[j]->get_id());
+                }
+            }
+
+            // clusters numbered in the order of their first constraint or scheduler
+            std::map<int, m2_cluster *> cluster_of;
+            for (unsigned i = 0; i < constraints.size(); i++)
+            {
+                if (constraint_events[i].empty())
+                {
+                    _clusters.push_back(new m2_cluster(_clusters.size()));
+                    _clusters.back()->add_constraint(constraints[i]);
+                    continue;
+                }
+                int root = sets.find(constraint_events[i][0]->get_id());
+                if (cluster_of.find(root) == cluster_of.end())
+                {
+                    cluster_of[root] = new m2_cluster(_clusters.size());
+                    _clusters.push_back(cluster_of[root]);
+                }
+                cluster_of[root]->add_constraint(constraints[i]);
+            }
+            for (unsigned i = 0; i < schedulers.size(); i++)
+            {
+                std::vector<m2_event *>& events = schedulers[i]->get_events();
+                if (schedulers[i]->is_global() || events.empty())
+                {
+                    _globals.push_back(schedulers[i]);
+                    continue;
+                }
+                int root = sets.find(events[0]->get_id());
+                if (cluster_of.find(root) == cluster_of.end())
+                {
+                    cluster_of[root] = new m2_cluster(_clusters.size());
+                    _clusters.push_back(cluster_of[root]);
+                }
+                cluster_of[root]->add_scheduler(schedulers[i]);
+            }
+
+            for (unsigned i = 0; i < _clusters.size(); i++)
+            {
+                _clusters[i]->elaborate();
+            }
+            _solver = solver;
+            _num_constraints = constraints.size();
+            _schedulers = schedulers;
+            for (unsigned i = 0; i < schedulers.size(); i++)
+            {
+                _num_events.push_back(schedulers[i]->get_events().size());
+            }
+            M2_DEBUG1("phase 3: " << _clusters.size() << " clusters, " << _globals.size() << " global schedulers");
+            return true;
+        }
+
+        // the phase 3 fixpoint, returns the number of rounds
+        long resolve(m2_phase_stats* stats)
+        {
+            long rounds = 0;
+            bool again = true;
+            // phases 1 and 2 changed statuses
+            bool external_changes = true;
+            while (again)
+            {
+                rounds++;
+
+                _active.clear();
+                for (unsigned i = 0; i < _clusters.size(); i++)
+                {
+                    if (_clusters[i]->pending(external_changes))
+                        _active.push_back(_clusters[i]);
+                }
+                _next = 0;
+                _pool.run([this] () {
+                    unsigned k;
+                    while ((k = _next++) < _active.size())
+                        _active[k]->fixpoint();
+                });
+                for (unsigned i = 0; i < _active.size(); i++)
+                {
+                    _active[i]->apply_changes();
+                }
+
+                if (stats != NULL) stats->end_phase(M2_PHASE_SOLVING);
+
+                again = false;
+                unsigned long epoch = m2_event::epoch();
+                for (unsigned i = 0; i < _globals.size(); i++)
+                {
+                    if (!_globals[i]->touched())
+                        continue;
+                    _globals[i]->clear_touched();
+                    _globals[i]->schedule();
+                    if (!_globals[i]->is_stable())
+                        again = true;
+                }
+                external_changes = (m2_event::epoch() != epoch);
+                for (unsigned i = 0; (i < _clusters.size()) && !again; i++)
+                {
+                    if (_clusters[i]->pending(external_changes))
+                        again = true;
+                }
+
+                if (stats != NULL) stats->end_phase(M2_PHASE_SCHEDULING);
+            }
+            return rounds;
+        }
+
+        void post_resolve()
+        {
+            for (unsigned i = 0; i < _clusters.size(); i++)
+            {
+                _clusters[i]->post_resolve();
+            }
+        }
+    };
+
+} // end namespace m2_core
+
+#endif
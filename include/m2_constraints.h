@@ -16,6 +16,7 @@ namespace m2_core { // begin namespace m2_core
         M2_LTL_CONSTRAINT,
         M2_LOC_CONSTRAINT,
         M2_RENDEZ_CONSTRAINT,
+        M2_RENDEZ_GROUP_CONSTRAINT,
         UNKNOWN
     };
 
@@ -52,8 +53,17 @@ namespace m2_core { // begin namespace m2_core
 
         virtual bool isSatisfied() = 0; 
         virtual void solveConstraint() {};
+        virtual void elaborate() {};
         virtual bool is_stable() = 0;
         virtual void post_resolve() = 0;
+
+        // append the events the constraint reads or writes, used by the solver
+        // to re-solve the constraint only when one of them changes status.
+        // Constraints returning false are solved in every resolve().
+        virtual bool get_events(std::vector<m2_event *>& events)
+        {
+            return false;
+        }
     };
 
 
@@ -127,6 +137,13 @@ namespace m2_core { // begin namespace m2_core
             return stable;		
         }
 
+        bool get_events(std::vector<m2_event *>& events)
+        {
+            events.push_back(_m1);
+            events.push_back(_m2);
+            return true;
+        }
+
         void post_resolve()
         {
             if (_m1->get_status() == (char)M2_EVENT_DISABLED)
@@ -208,6 +225,206 @@ namespace m2_core { // begin namespace m2_core
         }
     };
 
+    //**************************************************************
+    // MetroII rendezvous group constraints 
+    //**************************************************************    
+    // N-way rendezvous. Events related by add() form equivalence classes
+    // (union-find), and each class is enabled only if all its events are
+    // proposed or waiting, otherwise all of them are disabled. Values are
+    // passed between the events of an enabled class like in
+    // m2_mapping_constraint.
+    class m2_rendez_group_constraint : public m2_constraint
+    {
+      protected:
+        std::vector<m2_event *> _events;
+        std::map<m2_event *, int> _index;   // position of each event in _events
+        m2_union_find _sets;
+        bool stable;
+
+        // classes in compressed form: the events of class k are
+        // _members[_class_start[k]] .. _members[_class_start[k + 1] - 1]
+        std::vector<int> _class_start;
+        std::vector<m2_event *> _members;
+        std::vector<int> _member_ids;
+        bool _elaborated;
+
+        int index_of(m2_event* e)
+        {
+            std::map<m2_event *, int>::iterator it = _index.find(e);
+            if (it != _index.end())
+                return it->second;
+
+            _events.push_back(e);
+            _index[e] = _sets.add();
+            _elaborated = false;
+            return _events.size() - 1;
+        }
+
+        bool class_satisfied(int k)
+        {
+            int n = _class_start[k + 1] - _class_start[k];
+            return event_table.count_status(&_member_ids[_class_start[k]], n, 
+                    M2_STATUS_MASK(M2_EVENT_PROPOSED) | M2_STATUS_MASK(M2_EVENT_WAITING)) == n;
+        }
+
+      public:
+        m2_rendez_group_constraint()
+            : m2_constraint(M2_RENDEZ_GROUP_CONSTRAINT)
+        {
+            stable = true;
+            _elaborated = false;
+        }
+
+        m2_rendez_group_constraint(const char* name)
+            : m2_constraint(name, M2_RENDEZ_GROUP_CONSTRAINT)
+        {
+            stable = true;
+            _elaborated = false;
+        }
+
+        // e1 and e2 have to occur together
+        void add(m2_event* e1, m2_event* e2)
+        {
+            _sets.unite(index_of(e1), index_of(e2));
+        }
+
+        // all the events have to occur together
+        void add(const std::vector<m2_event *>& events)
+        {
+            for (unsigned i = 1; i < events.size(); i++)
+            {
+                add(events[0], events[i]);
+            }
+        }
+
+        void elaborate()
+        {
+            if (_elaborated)
+                return;
+
+            // counting sort of the events by class representative
+            std::vector<int> class_of(_events.size());
+            std::vector<int> root_class(_events.size(), -1);
+            int num_classes = 0;
+            for (unsigned i = 0; i < _events.size(); i++)
+            {
+                int root = _sets.find(i);
+                if (root_class[root] < 0)
+                {
+                    root_class[root] = num_classes++;
+                }
+                class_of[i] = root_class[root];
+            }
+
+            _class_start.assign(num_classes + 1, 0);
+            for (unsigned i = 0; i < _events.size(); i++)
+            {
+                _class_start[class_of[i] + 1]++;
+            }
+            for (int k = 0; k < num_classes; k++)
+            {
+                _class_start[k + 1] += _class_start[k];
+            }
+
+            std::vector<int> next(_class_start.begin(), _class_start.end() - 1);
+            _members.resize(_events.size());
+            _member_ids.resize(_events.size());
+            for (unsigned i = 0; i < _events.size(); i++)
+            {
+                int pos = next[class_of[i]]++;
+                _members[pos] = _events[i];
+                _member_ids[pos] = _events[i]->get_id();
+            }
+            _elaborated = true;
+        }
+
+        int get_num_classes()
+        {
+            elaborate();
+            return _class_start.size() - 1;
+        }
+
+        bool isSatisfied()
+        {
+            elaborate();
+            for (unsigned k = 0; k + 1 < _class_start.size(); k++)
+            {
+                if (!class_satisfied(k))
+                    return false;
+            }
+            return true;
+        }
+
+        void solveConstraint()
+        {
+            elaborate();
+            stable = true;
+            for (unsigned k = 0; k + 1 < _class_start.size(); k++)
+            {
+                char target = class_satisfied(k) ? (char)M2_EVENT_PROPOSED : (char)M2_EVENT_DISABLED;
+                for (int j = _class_start[k]; j < _class_start[k + 1]; j++)
+                {
+                    char status = _members[j]->get_status();
+                    if ((status != target) && ((status == (char)M2_EVENT_PROPOSED)
+                                || (status == (char)M2_EVENT_WAITING)))
+                    {
+                        _members[j]->set_status(target);
+                        stable = false;
+                    }
+                }
+            }
+        }
+
+        bool is_stable()
+        {
+            return stable;
+        }
+
+        bool get_events(std::vector<m2_event *>& events)
+        {
+            events.insert(events.end(), _events.begin(), _events.end());
+            return true;
+        }
+
+        void post_resolve()
+        {
+            elaborate();
+            for (unsigned k = 0; k + 1 < _class_start.size(); k++)
+            {
+                int first = _class_start[k];
+                int last = _class_start[k + 1];
+                int n = last - first;
+
+                for (int j = first; j < last; j++)
+                {
+                    if (_members[j]->get_status() == (char)M2_EVENT_DISABLED)
+                    {
+                        _members[j]->set_status((char)M2_EVENT_WAITING);
+                    }
+                }
+
+                if (event_table.count_status(&_member_ids[first], n, M2_STATUS_MASK(M2_EVENT_PROPOSED)) != n)
+                    continue;
+
+                // the first determined value is passed to the undetermined ones
+                double val = NONDET;
+                for (int j = first; (j < last) && (val == NONDET); j++)
+                {
+                    val = _members[j]->val;
+                }
+                if (val == NONDET)
+                    continue;
+                for (int j = first; j < last; j++)
+                {
+                    if (_members[j]->val == NONDET)
+                    {
+                        _members[j]->val = val;
+                    }
+                }
+            }
+        }
+    };
+
     //**************************************************************
     // MetroII constraint solver 
     //**************************************************************    
@@ -215,51 +432,139 @@ namespace m2_core { // begin namespace m2_core
     {
       private:
         std::vector<m2_constraint *> _constraint_list;
+        std::vector<int> _unindexed;    // constraints that do not report their events
+        m2_worklist _dirty;             // constraints to solve, queued by status changes
+        m2_worklist _solved;            // constraints solved since the last post_resolve
+        bool _indexed;
+        bool _stable;
+
+        void index_constraint(int i)
+        {
+            std::vector<m2_event *> events;
+
+            _dirty.resize(_constraint_list.size());
+            _solved.resize(_constraint_list.size());
+            _constraint_list[i]->elaborate();
+            if (_constraint_list[i]->get_events(events))
+            {
+                for (unsigned j = 0; j < events.size(); j++)
+                {
+                    events[j]->add_watcher(&_dirty, i);
+                }
+                _dirty.push(i);
+            }
+            else {
+                _unindexed.push_back(i);
+            }
+        }
+
+        void solve(int i)
+        {
+            _constraint_list[i]->solveConstraint();
+            if (!_constraint_list[i]->is_stable())
+            {
+                _stable = false;
+            }
+        }
 
       public:
         m2_constraint_solver()
         {
+            _indexed = false;
+            _stable = true;
         }
 
         m2_constraint_solver(const std::vector<m2_constraint *> constraint_list)
         {
-            m2_constraint_solver();
+            _indexed = false;
+            _stable = true;
             _constraint_list = constraint_list;
         }
 
         void addConstraint(m2_constraint* c)
         {
             _constraint_list.push_back(c);
+            if (_indexed)
+            {
+                index_constraint(_constraint_list.size() - 1);
+            }
         }
 
-        void resolve()
+        // build the event to constraint dependency index, called by m2_start
+        void elaborate()
         {
+            if (_indexed)
+                return;
+
             for (unsigned i = 0; i < _constraint_list.size(); i ++)
             {
-                _constraint_list[i]->solveConstraint();
+                index_constraint(i);
             }
+            _indexed = true;
         }
 
-        bool is_stable()
+        // solve the constraints until none of their events changes any more,
+        // only constraints whose events changed status since they were last
+        // solved are visited
+        void resolve()
         {
-            bool stable = true;
-            for (unsigned i = 0; i < _constraint_list.size(); i ++)
+            if (!_indexed)
             {
-                if (!_constraint_list[i]->is_stable())
-                {
-                    stable = false;
-                }
+                elaborate();
             }
 
-            return stable;
+            _stable = true;
+            for (unsigned i = 0; i < _unindexed.size(); i ++)
+            {
+                solve(_unindexed[i]);
+            }
+            while (!_dirty.empty())
+            {
+                // changes made by the constraint itself do not queue it again
+                int i = _dirty.pop();
+                solve(i);
+                _dirty.done(i);
+                _solved.push(i);
+            }
         }
 
+        bool is_stable()
+        {
+            return _stable;
+        }
+
+        // resolve() has constraints to solve
+        bool has_work()
+        {
+            return !_indexed || !_unindexed.empty() || !_dirty.empty();
+        }
+
+        std::vector<m2_constraint *>& get_constraints()
+        {
+            return _constraint_list;
+        }
+
+        // phase 3 cluster the solver belongs to, see m2_cluster
+        void set_cluster(int cluster)
+        {
+            _dirty.set_cluster(cluster);
+            _solved.set_cluster(cluster);
+        }
+
+        // a constraint that was not solved in this iteration has no disabled or
+        // newly proposed events, so only the solved ones are post-processed
         void post_resolve()
         {
-            for (unsigned i = 0; i < _constraint_list.size(); i ++)
+            for (unsigned i = 0; i < _unindexed.size(); i ++)
+            {
+                _constraint_list[_unindexed[i]]->post_resolve();
+            }
+            while (!_solved.empty())
             {
+                int i = _solved.pop();
+                _solved.done(i);
                 _constraint_list[i]->post_resolve();
-            }		
+            }
         }
     };
 
@@ -0,0 +1,247 @@
+// Parametric cost kernels and the batch annotator applying them
+
+#ifndef M2_COST_H
+#define M2_COST_H
+
+#include "m2_base.h"
+#include "m2_event_table.h"
+#include "m2_ann_sched.h"
+
+namespace m2_core { // begin namespace m2_core
+
+    // 2 doubles, processed at once by the cost kernels
+    typedef double m2_double_vector __attribute__ ((vector_size (16)));
+
+#define M2_DOUBLE_LANES 2
+
+    inline m2_double_vector m2_broadcast(double x)
+    {
+        m2_double_vector v = {x, x};
+        return v;
+    }
+
+    //******************************************************************************
+    // Cost kernel
+    //******************************************************************************
+    // Computes the cost of n events from their quantities (the val of the
+    // events, NONDET taken as 0).
+    class m2_cost_kernel
+    {
+      public:
+        virtual ~m2_cost_kernel() {}
+
+        virtual void evaluate(const double* quantity, double* cost, int n) = 0;
+    };
+
+    //******************************************************************************
+    // base + per_item * quantity
+    //******************************************************************************
+    class m2_linear_cost : public m2_cost_kernel
+    {
+      private:
+        double _base;
+        double _per_item;
+
+      public:
+        m2_linear_cost(double base, double per_item = 0)
+        {
+            _base = base;
+            _per_item = per_item;
+        }
+
+        void evaluate(const double* quantity, double* cost, int n)
+        {
+            m2_double_vector base = m2_broadcast(_base);
+            m2_double_vector per_item = m2_broadcast(_per_item);
+            int i = 0;
+            for (; i + M2_DOUBLE_LANES <= n; i += M2_DOUBLE_LANES)
+            {
+                m2_double_vector q;
+                memcpy(&q, quantity + i, sizeof(q));
+                q = base + per_item * q;
+                memcpy(cost + i, &q, sizeof(q));
+            }
+            for (; i < n; i++)
+            {
+                cost[i] = _base + _per_item * quantity[i];
+            }
+        }
+    };
+
+    //******************************************************************************
+    // Piecewise linear function of the quantity
+    //******************************************************************************
+    // Given by points (x_0, y_0) ... (x_k, y_k) with strictly increasing x;
+    // the cost is y_0 below x_0 and y_k above x_k. It is evaluated as y_0 plus
+    // the sum over the segments of slope * (clamp(x, x_i, x_i+1) - x_i),
+    // without branches. Invalid points are reported as an error and give
+    // the constant cost y_0.
+    class m2_piecewise_linear_cost : public m2_cost_kernel
+    {
+      private:
+        std::vector<double> _x;
+        std::vector<double> _slope;     // of the segment starting at _x[i]
+        double _y0;
+
+      public:
+        m2_piecewise_linear_cost(const std::vector<double>& x, const std::vector<double>& y)
+        {
+            _y0 = y.empty() ? 0 : y[0];
+            if (x.size() != y.size())
+            {
+                SC_REPORT_ERROR("m2_piecewise_linear_cost", "x and y have different sizes");
+                return;
+            }
+            for (unsigned i = 0; i + 1 < x.size(); i++)
+            {
+                if (!(x[i] < x[i + 1]))
+                {
+                    SC_REPORT_ERROR("m2_piecewise_linear_cost", "x is not strictly increasing");
+                    _slope.clear();
+                    return;
+                }
+                _slope.push_back((y[i + 1] - y[i]) / (x[i + 1] - x[i]));
+            }
+            _x = x;
+        }
+
+        void evaluate(const double* quantity, double* cost, int n)
+        {
+            int i = 0;
+            for (; i + M2_DOUBLE_LANES <= n; i += M2_DOUBLE_LANES)
+            {
+                m2_double_vector q;
+                memcpy(&q, quantity + i, sizeof(q));
+                m2_double_vector c = m2_broadcast(_y0);
+                for (unsigned k = 0; k < _slope.size(); k++)
+                {
+                    m2_double_vector lo = m2_broadcast(_x[k]);
+                    m2_double_vector hi = m2_broadcast(_x[k + 1]);
+                    m2_double_vector x = (q < lo) ? lo : q;
+                    x = (x > hi) ? hi : x;
+                    c += m2_broadcast(_slope[k]) * (x - lo);
+                }
+                memcpy(cost + i, &c, sizeof(c));
+            }
+            for (; i < n; i++)
+            {
+                double c = _y0;
+                for (unsigned k = 0; k < _slope.size(); k++)
+                {
+                    double x = std::min(std::max(quantity[i], _x[k]), _x[k + 1]);
+                    c += _slope[k] * (x - _x[k]);
+                }
+                cost[i] = c;
+            }
+        }
+    };
+
+    //******************************************************************************
+    // MetroII cost annotator
+    //******************************************************************************
+    // Sets (or adds to) quantities of the proposed events the costs computed
+    // by kernels from an input quantity (val unless set_input is called,
+    // NONDET taken as 0). The input of a batch is gathered once into a
+    // contiguous array, every kernel runs over it, and each result is
+    // scattered back to the column of its quantity. The kernel given to the
+    // constructor writes the tag, add_output adds kernels for other
+    // quantities (energy, bytes, ...).
+    class m2_cost_annotator : public m2_batch_annotator
+    {
+      private:
+        int _input;
+        std::vector<int> _outputs;      // quantity indices
+        std::vector<m2_cost_kernel *> _kernels;
+        bool _accumulate;
+        std::vector<double> _quantity;
+        std::vector<double> _cost;
+
+        void init(m2_cost_kernel* kernel)
+        {
+            _input = M2_QUANTITY_VAL;
+            _accumulate = false;
+            declare_read("val");
+            if (kernel != NULL)
+                add_output("tag", kernel);
+        }
+
+      public:
+        // kernel computes the tag, NULL if only add_output is used
+        m2_cost_annotator(m2_cost_kernel* kernel)
+            : m2_batch_annotator()
+        {
+            init(kernel);
+        }
+
+        m2_cost_annotator(const char* name, m2_cost_kernel* kernel)
+            : m2_batch_annotator(name)
+        {
+            init(kernel);
+        }
+
+        m2_cost_annotator(const std::vector<m2_event *> event_list, m2_cost_kernel* kernel)
+            : m2_batch_annotator(event_list)
+        {
+            init(kernel);
+        }
+
+        m2_cost_annotator(const char* name, const std::vector<m2_event *> event_list, m2_cost_kernel* kernel)
+            : m2_batch_annotator(name, event_list)
+        {
+            init(kernel);
+        }
+
+        // the quantity the kernels take, registered if needed
+        void set_input(const char* quantity)
+        {
+            _input = event_table.register_quantity(quantity);
+            declare_read(quantity);
+        }
+
+        // kernel computes the given quantity, registered if needed
+        void add_output(const char* quantity, m2_cost_kernel* kernel)
+        {
+            _outputs.push_back(event_table.register_quantity(quantity));
+            _kernels.push_back(kernel);
+            declare_write(quantity);
+        }
+
+        // add the costs to the quantities instead of replacing them
+        void set_accumulate(bool accumulate)
+        {
+            _accumulate = accumulate;
+        }
+
+        void annotate_batch(const int* ids, int n)
+        {
+            std::vector<double>& input = event_table.column(_input);
+
+            _quantity.resize(n);
+            _cost.resize(n);
+            for (int i = 0; i < n; i++)
+            {
+                double v = input[ids[i]];
+                _quantity[i] = (v == NONDET) ? 0 : v;
+            }
+
+            for (unsigned k = 0; k < _kernels.size(); k++)
+            {
+                std::vector<double>& output = event_table.column(_outputs[k]);
+                _kernels[k]->evaluate(_quantity.data(), _cost.data(), n);
+
+                if (_accumulate)
+                {
+                    for (int i = 0; i < n; i++)
+                        output[ids[i]] += _cost[i];
+                }
+                else {
+                    for (int i = 0; i < n; i++)
+                        output[ids[i]] = _cost[i];
+                }
+            }
+        }
+    };
+
+} // end namespace m2_core
+
+#endif
@@ -0,0 +1,224 @@
+// Binary cost tables: full event names and costs, sorted by name, mapped
+// read-only from a file so that simulations on one machine share the pages
+
+#ifndef M2_COST_TABLE_H
+#define M2_COST_TABLE_H
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define M2_COST_TABLE_MAGIC "M2COST\0\0"
+#define M2_COST_TABLE_VERSION 1
+
+namespace m2_core { // begin namespace m2_core
+
+    // layout of a cost table file: the header, count entries sorted by name,
+    // then the names, NUL terminated
+    struct m2_cost_table_header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t count;
+        uint64_t names_offset;  // from the start of the file
+        uint64_t names_size;
+    };
+
+    struct m2_cost_table_entry
+    {
+        uint64_t name;          // offset in the names
+        double cost;
+    };
+
+    //******************************************************************************
+    // Cost table file
+    //******************************************************************************
+    // Lookups are binary searches on the names; the physical time annotator
+    // does them once per event, when it binds its events at elaboration.
+    class m2_cost_table
+    {
+      private:
+        void* _data;
+        size_t _size;
+        const m2_cost_table_entry* _entries;
+        const char* _names;
+        uint32_t _count;
+
+        static bool entry_less(const std::pair<std::string, double>& a, const std::pair<std::string, double>& b)
+        {
+            return strcmp(a.first.c_str(), b.first.c_str()) < 0;
+        }
+
+      public:
+        m2_cost_table()
+        {
+            _data = NULL;
+            _size = 0;
+            _entries = NULL;
+            _names = NULL;
+            _count = 0;
+        }
+
+        ~m2_cost_table()
+        {
+            close();
+        }
+
+        // returns false if the file cannot be mapped or is not a cost table
+        bool open(const char* path)
+        {
+            close();
+            int fd = ::open(path, O_RDONLY);
+            if (fd < 0)
+                return false;
+            struct stat st;
+            if ((fstat(fd, &st) != 0) || (st.st_size < (off_t)sizeof(m2_cost_table_header)))
+            {
+                ::close(fd);
+                return false;
+            }
+            void* data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (data == MAP_FAILED)
+                return false;
+
+            const m2_cost_table_header* header = (const m2_cost_table_header *)data;
+            uint64_t entries_end = sizeof(m2_cost_table_header) + (uint64_t)header->count * sizeof(m2_cost_table_entry);
+            if ((memcmp(header->magic, M2_COST_TABLE_MAGIC, 8) != 0) || (header->version != M2_COST_TABLE_VERSION)
+                    || (entries_end > header->names_offset)
+                    || (header->names_offset > (uint64_t)st.st_size)
+                    || (header->names_size > (uint64_t)st.st_size - header->names_offset))
+            {
+                munmap(data, st.st_size);
+                return false;
+            }
+
+            // every name must start inside the names and end with a NUL
+            const m2_cost_table_entry* entries = (const m2_cost_table_entry *)((const char *)data + sizeof(m2_cost_table_header));
+            const char* names = (const char *)data + header->names_offset;
+            bool valid = (header->count == 0) || ((header->names_size > 0) && (names[header->names_size - 1] == 0));
+            for (uint32_t i = 0; valid && (i < header->count); i++)
+            {
+                valid = (entries[i].name < header->names_size);
+            }
+            if (!valid)
+            {
+                munmap(data, st.st_size);
+                return false;
+            }
+
+            _data = data;
+            _size = st.st_size;
+            _count = header->count;
+            _entries = entries;
+            _names = names;
+            return true;
+        }
+
+        void close()
+        {
+            if (_data != NULL)
+            {
+                munmap(_data, _size);
+            }
+            _data = NULL;
+            _size = 0;
+            _entries = NULL;
+            _names = NULL;
+            _count = 0;
+        }
+
+        bool is_open()
+        {
+            return _data != NULL;
+        }
+
+        int size()
+        {
+            return _count;
+        }
+
+        const char* name(int i)
+        {
+            return _names + _entries[i].name;
+        }
+
+        double cost(int i)
+        {
+            return _entries[i].cost;
+        }
+
+        // cost of the event with the given full name, false if there is none
+        bool lookup(const char* full_name, double& cost)
+        {
+            int low = 0;
+            int high = _count;
+            while (low < high)
+            {
+                int middle = low + (high - low) / 2;
+                int c = strcmp(name(middle), full_name);
+                if (c == 0)
+                {
+                    cost = _entries[middle].cost;
+                    return true;
+                }
+                if (c < 0)
+                    low = middle + 1;
+                else
+                    high = middle;
+            }
+            return false;
+        }
+
+        // writes a cost table file, the last of duplicate names is kept
+        static bool write(const char* path, std::vector<std::pair<std::string, double> > entries)
+        {
+            std::stable_sort(entries.begin(), entries.end(), entry_less);
+            std::vector<std::pair<std::string, double> > unique;
+            for (unsigned i = 0; i < entries.size(); i++)
+            {
+                if (!unique.empty() && (unique.back().first == entries[i].first))
+                    unique.back() = entries[i];
+                else
+                    unique.push_back(entries[i]);
+            }
+
+            m2_cost_table_header header;
+            memset(&header, 0, sizeof(header));
+            memcpy(header.magic, M2_COST_TABLE_MAGIC, 8);
+            header.version = M2_COST_TABLE_VERSION;
+            header.count = unique.size();
+            header.names_offset = sizeof(header) + unique.size() * sizeof(m2_cost_table_entry);
+
+            std::vector<m2_cost_table_entry> table(unique.size());
+            std::string names;
+            for (unsigned i = 0; i < unique.size(); i++)
+            {
+                table[i].name = names.size();
+                table[i].cost = unique[i].second;
+                names.append(unique[i].first);
+                names.push_back('\0');
+            }
+            header.names_size = names.size();
+
+            FILE* f = fopen(path, "wb");
+            if (f == NULL)
+                return false;
+            bool ok = (fwrite(&header, sizeof(header), 1, f) == 1)
+                && (table.empty() || (fwrite(&table[0], sizeof(m2_cost_table_entry), table.size(), f) == table.size()))
+                && (names.empty() || (fwrite(names.data(), 1, names.size(), f) == names.size()));
+            return (fclose(f) == 0) && ok;
+        }
+    };
+
+} // end namespace m2_core
+
+#endif
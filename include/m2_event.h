@@ -5,6 +5,9 @@
 #define M2_EVENT_H
 
 #include "m2_base.h"
+#include "m2_event_table.h"
+#include "m2_pool.h"
+#include <atomic>
 
 namespace m2_core { // begin namespace m2_core 
 
@@ -38,55 +41,88 @@ namespace m2_core { // begin namespace m2_core
       private:
         const char* _name;
         const char* _full_name;
-        char _status;
         sc_process_handle _owner;
+        M2_Event_Types _type;
+        m2_event* _partner; // end event of a begin event and vice versa
+        int _id;            // dense ID assigned by the event table
+        int _dirty_index;   // position in _dirty_events, -1 if not queued
+        int _pending_index; // position in the manager's pending set, -1 if not pending
 
-      public:
-        //map<string, double> tag;
-        //map<string, double> val;
+        // worklists notified when the status changes, with the index to queue
+        std::vector<event_watcher_t> _watchers;
 
-        double tag;
-        double val;
+        // events whose status changed since the last clear_dirty_events()
+        static std::vector<m2_event *> _dirty_events;
 
-        m2_event()
+        // incremented by every status change of any event
+        static std::atomic<unsigned long> _epoch;
+
+        // changes of the cluster run by the current thread, NULL on the simulation thread
+        static thread_local m2_deferred_changes* _deferred;
+
+        void init(const char * name, sc_process_handle owner, M2_Event_Types type)
         {
-            char * _temp;
-            _name = "unknown";
-            _status = (char) M2_EVENT_INACTIVE;
-            _owner = sc_get_current_process_handle();
-            STR_CAT(_temp, _owner.name(), _name);
-            _full_name = _temp;
+            _name = name;
+            _owner = owner;
+            _type = type;
+            _partner = NULL;
+            _full_name = name_arena.intern(_owner.name(), _name);
+            _dirty_index = -1;
+            _pending_index = -1;
+            _id = event_table.register_event(this);
+            tag.bind(&event_table.tag_column(), _id);
+            val.bind(&event_table.val_column(), _id);
+            event_table.set_status(_id, (char) M2_EVENT_INACTIVE);
             val = NONDET;
         }
 
+      public:
+        // stored in the event table, indexed by the event ID; the other
+        // quantities are read and written with get_quantity and set_quantity
+        m2_event_field tag;
+        m2_event_field val;
+
+        m2_event()
+        {
+            init("unknown", sc_get_current_process_handle(), M2_EVENT_GENERIC);
+        }
+
         m2_event(const char * name)
         {
-            char * _temp;
-            _name = name;
-            _status = (char) M2_EVENT_INACTIVE;
-            _owner  = sc_get_current_process_handle();
-            STR_CAT(_temp, _owner.name(), _name);
-            _full_name = _temp;
-            val = NONDET;
+            init(name, sc_get_current_process_handle(), M2_EVENT_GENERIC);
+        }
+
+        m2_event(const char * name, M2_Event_Types type)
+        {
+            init(name, sc_get_current_process_handle(), type);
         }
 
         m2_event(const char * name, sc_process_handle owner)
         {
-            char * _temp;
-            _name = name;
-            _status = (char) M2_EVENT_INACTIVE;
-            _owner  = owner;
-            STR_CAT(_temp, _owner.name(), _name);
-            _full_name = _temp;
-            val = NONDET;
+            init(name, owner, M2_EVENT_GENERIC);
         }
 
+        m2_event(const char * name, sc_process_handle owner, M2_Event_Types type)
+        {
+            init(name, owner, type);
+        }
+
+        // leaves the dirty list, the manager's pending set and the event
+        // table (in metroII.cpp); constraints and schedulers the event was
+        // added to must not use it anymore
+        ~m2_event();
+
+        static void* operator new(size_t size);
+        static void operator delete(void* p, size_t size);
+
+        // the clone belongs to the caller
         m2_event& clone(sc_process_handle owner) {
-            m2_event* n = new m2_event(_name);
-            n->set_status(_status);
+            m2_event* n = new m2_event(_name, _type);
+            n->set_status(get_status());
             n->set_owner(owner);
             n->tag = tag;
             n->val = val;
+            event_table.copy_quantities(_id, n->_id);
             return (*n);
         }
 
@@ -96,12 +132,110 @@ namespace m2_core { // begin namespace m2_core
 
         void set_status(char status)
         {
-            _status = status;
+            if (status != event_table.get_status(_id))
+            {
+                event_table.set_status(_id, status);
+                _epoch.fetch_add(1, std::memory_order_relaxed);
+                mark_dirty();
+                m2_deferred_changes* deferred = _deferred;
+                for (unsigned i = 0; i < _watchers.size(); i++)
+                {
+                    if ((deferred != NULL) && (_watchers[i].first->get_cluster() != deferred->cluster))
+                        deferred->watchers.push_back(_watchers[i]);
+                    else
+                        _watchers[i].first->push(_watchers[i].second);
+                }
+            }
+        }
+
+        // number of status changes of all the events so far; comparing it
+        // before and after a step tells whether the step changed any status
+        static unsigned long epoch()
+        {
+            return _epoch.load(std::memory_order_relaxed);
+        }
+
+        // queue index on worklist every time the status of the event changes
+        void add_watcher(m2_worklist* worklist, int index)
+        {
+            _watchers.push_back(event_watcher_t(worklist, index));
+        }
+
+        // queue the event on the dirty list, at most once until the list is cleared
+        void mark_dirty()
+        {
+            if (_dirty_index < 0)
+            {
+                std::vector<m2_event *>& dirty = (_deferred != NULL) ? _deferred->dirty : _dirty_events;
+                _dirty_index = dirty.size();
+                dirty.push_back(this);
+            }
+        }
+
+        // true on a phase 3 cluster thread
+        static bool deferring()
+        {
+            return _deferred != NULL;
+        }
+
+        // collect the changes made by the current thread in changes (NULL to stop)
+        static void defer_changes(m2_deferred_changes* changes)
+        {
+            _deferred = changes;
+        }
+
+        // called by the simulation thread once the thread that collected the
+        // changes has finished
+        static void apply_changes(m2_deferred_changes& changes)
+        {
+            for (unsigned i = 0; i < changes.dirty.size(); i++)
+            {
+                changes.dirty[i]->_dirty_index = _dirty_events.size();
+                _dirty_events.push_back(changes.dirty[i]);
+            }
+            for (unsigned i = 0; i < changes.watchers.size(); i++)
+            {
+                changes.watchers[i].first->push(changes.watchers[i].second);
+            }
+            changes.dirty.clear();
+            changes.watchers.clear();
+        }
+
+        static std::vector<m2_event *>& get_dirty_events()
+        {
+            return _dirty_events;
+        }
+
+        static void clear_dirty_events()
+        {
+            for (unsigned i = 0; i < _dirty_events.size(); i++)
+            {
+                if (_dirty_events[i] != NULL)
+                {
+                    _dirty_events[i]->_dirty_index = -1;
+                }
+            }
+            _dirty_events.clear();
+        }
+
+        int get_pending_index()
+        {
+            return _pending_index;
+        }
+
+        void set_pending_index(int index)
+        {
+            _pending_index = index;
+        }
+
+        bool is_pending()
+        {
+            return _pending_index >= 0;
         }
 
         char get_status()
         {
-            return _status;
+            return event_table.get_status(_id);
         }
 
         void set_owner(sc_process_handle owner)
@@ -114,6 +248,38 @@ namespace m2_core { // begin namespace m2_core
             return _owner;
         }
 
+        int get_id()
+        {
+            return _id;
+        }
+
+        // q is the index of a quantity registered in the event table
+        double get_quantity(int q)
+        {
+            return event_table.column(q)[_id];
+        }
+
+        void set_quantity(int q, double v)
+        {
+            event_table.column(q)[_id] = v;
+        }
+
+        M2_Event_Types get_type()
+        {
+            return _type;
+        }
+
+        // begin and end events of the same method call know each other
+        void set_partner(m2_event* partner)
+        {
+            _partner = partner;
+        }
+
+        m2_event* get_partner()
+        {
+            return _partner;
+        }
+
         const char * get_full_name()
         {
             return _full_name;
@@ -126,17 +292,18 @@ namespace m2_core { // begin namespace m2_core
 
         const char * string_status()
         {
+            char status = get_status();
             char * message;
             message = "";
-            if (_status == (char)M2_EVENT_INACTIVE)
+            if (status == (char)M2_EVENT_INACTIVE)
                 message = "Inactive";
-            if (_status == (char)M2_EVENT_PROPOSED)
+            if (status == (char)M2_EVENT_PROPOSED)
                 message = "Proposed";
-            if (_status == (char)M2_EVENT_WAITING)
+            if (status == (char)M2_EVENT_WAITING)
                 message = "Waiting";
-            if (_status == (char)M2_EVENT_NOTIFIED)
+            if (status == (char)M2_EVENT_NOTIFIED)
                 message = "Notified";
-            if (_status == (char)M2_EVENT_DISABLED)
+            if (status == (char)M2_EVENT_DISABLED)
                 message = "Disabled";
             return message;
         }
@@ -162,11 +329,10 @@ namespace m2_core { // begin namespace m2_core
             val = NONDET;
         }
 
+        // the name is shared with the event (interned in name_arena)
         m2_event_info(m2_event& e)
         {
-            char * temp;
-            temp = (char *)malloc(strlen(e.get_full_name()) + 1);
-            name = temp;
+            name = e.get_full_name();
             tag = e.tag;
             val = e.val;
             status = e.get_status(); 
@@ -179,12 +345,50 @@ namespace m2_core { // begin namespace m2_core
             e.set_status(status);
         }
 
-        ~m2_event_info()
-        {
-            free((void *)name);
-        }
+        static void* operator new(size_t size);
+        static void operator delete(void* p, size_t size);
     };
 
+    extern m2_pool<m2_event> event_pool;
+    extern m2_pool<m2_event_info> event_info_pool;
+
+    // events and event infos come from their pools, derived classes of a
+    // different size use the global heap
+
+    inline void* m2_event::operator new(size_t size)
+    {
+        if (size != sizeof(m2_event))
+            return ::operator new(size);
+        return event_pool.allocate();
+    }
+
+    inline void m2_event::operator delete(void* p, size_t size)
+    {
+        if (p == NULL)
+            return;
+        if (size != sizeof(m2_event))
+            ::operator delete(p);
+        else
+            event_pool.release(p);
+    }
+
+    inline void* m2_event_info::operator new(size_t size)
+    {
+        if (size != sizeof(m2_event_info))
+            return ::operator new(size);
+        return event_info_pool.allocate();
+    }
+
+    inline void m2_event_info::operator delete(void* p, size_t size)
+    {
+        if (p == NULL)
+            return;
+        if (size != sizeof(m2_event_info))
+            ::operator delete(p);
+        else
+            event_info_pool.release(p);
+    }
+
 } // begin namespace m2_core 
 
 #endif
@@ -0,0 +1,372 @@
+// Event table: dense integer event IDs, the name to ID symbol table and the
+// event state (status, tag, val and other quantities) stored in contiguous
+// arrays indexed by ID
+
+#ifndef M2_EVENT_TABLE_H
+#define M2_EVENT_TABLE_H
+
+#include "m2_base.h"
+#include <string>
+
+// bit of an event status in the status masks taken by the scan helpers
+#define M2_STATUS_MASK(status) (1 << (status))
+
+// number of values of M2_Event_Status
+#define M2_NUM_EVENT_STATUS 5
+
+// indices of the quantities every event has
+#define M2_QUANTITY_TAG 0
+#define M2_QUANTITY_VAL 1
+
+namespace m2_core { // begin namespace m2_core
+
+    class m2_event;
+
+    // 16 status bytes, processed at once by the scan helpers
+    typedef signed char m2_status_vector __attribute__ ((vector_size (16)));
+
+    //******************************************************************************
+    // MetroII event table
+    //******************************************************************************
+    // Every m2_event registers itself at creation and receives an ID. IDs of
+    // destroyed events are reused, so IDs stay dense and can index flat arrays.
+    // The symbol table maps full event names to IDs, it is built at elaboration
+    // (m2_start) and rebuilt lazily if events are created later.
+    //
+    // The status, tag and val of the events live in separate arrays, so that
+    // schedulers can scan the statuses of their events without touching the
+    // event objects. The scan helpers take a list of IDs and a status mask
+    // built with M2_STATUS_MASK, and compare 16 statuses at a time.
+    //
+    // Quantities (time, energy, bytes, ...) are columns of doubles indexed by
+    // event ID, registered by name; tag and val are the quantities 0 and 1.
+    // Annotators write and schedulers read the columns directly, with the
+    // index returned by register_quantity or quantity().
+    class m2_event_table
+    {
+      private:
+        std::vector<m2_event *> _events;    // indexed by event ID, NULL if the ID is free
+        std::vector<int> _free_ids;
+        std::vector<std::pair<const char*, int> > _symbols; // sorted by name
+        bool _symbols_valid;
+
+        std::vector<char> _status;
+        std::vector<double> _tag;
+        std::vector<double> _val;
+
+        std::vector<std::vector<double> *> _columns;    // by quantity index
+        std::vector<std::string> _quantity_names;
+        std::vector<double> _initial;                   // value of new events
+
+        static m2_status_vector gather(const char* status, const int* ids)
+        {
+            m2_status_vector v;
+            for (int j = 0; j < 16; j++)
+            {
+                v[j] = status[ids[j]];
+            }
+            return v;
+        }
+
+        // lanes whose status is in the mask are set to -1, the others to 0
+        static m2_status_vector match(m2_status_vector v, int mask)
+        {
+            m2_status_vector r = {0};
+            for (int s = 0; s < M2_NUM_EVENT_STATUS; s++)
+            {
+                if (mask & M2_STATUS_MASK(s))
+                {
+                    r |= (v == (signed char)s);
+                }
+            }
+            return r;
+        }
+
+      public:
+        m2_event_table()
+        {
+            _symbols_valid = false;
+            _columns.push_back(&_tag);
+            _quantity_names.push_back("tag");
+            _initial.push_back(0);
+            _columns.push_back(&_val);
+            _quantity_names.push_back("val");
+            _initial.push_back(NONDET);
+        }
+
+        ~m2_event_table()
+        {
+            for (unsigned q = M2_QUANTITY_VAL + 1; q < _columns.size(); q++)
+            {
+                delete _columns[q];
+            }
+        }
+
+        int register_event(m2_event* e)
+        {
+            int id;
+            if (_free_ids.empty())
+            {
+                id = _events.size();
+                _events.push_back(e);
+                _status.push_back(0);
+                for (unsigned q = 0; q < _columns.size(); q++)
+                {
+                    _columns[q]->push_back(_initial[q]);
+                }
+            }
+            else {
+                id = _free_ids.back();
+                _free_ids.pop_back();
+                _events[id] = e;
+                _status[id] = 0;
+                for (unsigned q = 0; q < _columns.size(); q++)
+                {
+                    (*_columns[q])[id] = _initial[q];
+                }
+            }
+            _symbols_valid = false;
+            return id;
+        }
+
+        void unregister_event(int id)
+        {
+            _events[id] = NULL;
+            _free_ids.push_back(id);
+            _symbols_valid = false;
+        }
+
+        // number of IDs handed out so far, i.e. the size of arrays indexed by ID
+        int size()
+        {
+            return _events.size();
+        }
+
+        m2_event* get_event(int id)
+        {
+            return _events[id];
+        }
+
+        void build_symbol_table();
+
+        // returns the ID of the event with the given full name, -1 if unknown
+        int lookup(const char* full_name);
+
+        m2_event* find_event(const char* full_name)
+        {
+            int id = lookup(full_name);
+            return (id < 0) ? NULL : _events[id];
+        }
+
+        char get_status(int id)
+        {
+            return _status[id];
+        }
+
+        void set_status(int id, char status)
+        {
+            _status[id] = status;
+        }
+
+        char* status_data()
+        {
+            return _status.data();
+        }
+
+        std::vector<double>& tag_column()
+        {
+            return _tag;
+        }
+
+        std::vector<double>& val_column()
+        {
+            return _val;
+        }
+
+        // returns the index of the quantity, registered with the given
+        // initial value if it does not exist yet
+        int register_quantity(const char* name, double initial = 0)
+        {
+            int q = quantity(name);
+            if (q >= 0)
+                return q;
+            _columns.push_back(new std::vector<double>(_events.size(), initial));
+            _quantity_names.push_back(name);
+            _initial.push_back(initial);
+            return _columns.size() - 1;
+        }
+
+        // returns the index of the quantity, -1 if it is not registered
+        int quantity(const char* name)
+        {
+            for (unsigned q = 0; q < _quantity_names.size(); q++)
+            {
+                if (_quantity_names[q] == name)
+                    return q;
+            }
+            return -1;
+        }
+
+        int num_quantities()
+        {
+            return _columns.size();
+        }
+
+        const char* quantity_name(int q)
+        {
+            return _quantity_names[q].c_str();
+        }
+
+        std::vector<double>& column(int q)
+        {
+            return *_columns[q];
+        }
+
+        // copy the quantities other than tag and val of an event to another
+        void copy_quantities(int from, int to)
+        {
+            for (unsigned q = M2_QUANTITY_VAL + 1; q < _columns.size(); q++)
+            {
+                (*_columns[q])[to] = (*_columns[q])[from];
+            }
+        }
+
+        // copy the statuses of the given events to out
+        void gather_status(const int* ids, int n, char* out)
+        {
+            const char* status = _status.data();
+            for (int i = 0; i < n; i++)
+            {
+                out[i] = status[ids[i]];
+            }
+        }
+
+        // number of the given events whose status is in the mask
+        int count_status(const int* ids, int n, int mask)
+        {
+            const char* status = _status.data();
+            int count = 0;
+            int i = 0;
+            for (; i + 16 <= n; i += 16)
+            {
+                m2_status_vector r = match(gather(status, ids + i), mask);
+                for (int j = 0; j < 16; j++)
+                {
+                    count -= r[j];
+                }
+            }
+            for (; i < n; i++)
+            {
+                count += (mask >> status[ids[i]]) & 1;
+            }
+            return count;
+        }
+
+        // store in out the positions (in ids) of the events whose status is in
+        // the mask, returns how many were found
+        int select_status(const int* ids, int n, int mask, int* out)
+        {
+            const char* status = _status.data();
+            int count = 0;
+            int i = 0;
+            for (; i + 16 <= n; i += 16)
+            {
+                m2_status_vector r = match(gather(status, ids + i), mask);
+                for (int j = 0; j < 16; j++)
+                {
+                    out[count] = i + j;
+                    count -= r[j];
+                }
+            }
+            for (; i < n; i++)
+            {
+                out[count] = i;
+                count += (mask >> status[ids[i]]) & 1;
+            }
+            return count;
+        }
+
+        // number of the given events whose status differs from the snapshot
+        // taken with gather_status
+        int count_changed(const int* ids, int n, const char* snapshot)
+        {
+            const char* status = _status.data();
+            int count = 0;
+            int i = 0;
+            for (; i + 16 <= n; i += 16)
+            {
+                m2_status_vector old;
+                memcpy(&old, snapshot + i, 16);
+                m2_status_vector r = (gather(status, ids + i) != old);
+                for (int j = 0; j < 16; j++)
+                {
+                    count -= r[j];
+                }
+            }
+            for (; i < n; i++)
+            {
+                count += (status[ids[i]] != snapshot[i]);
+            }
+            return count;
+        }
+    };
+
+    //******************************************************************************
+    // Reference to the tag or the val of an event in the event table
+    //******************************************************************************
+    // Keeps e->tag and e->val usable as plain doubles although the values are
+    // stored in the columns of the event table.
+    class m2_event_field
+    {
+      private:
+        std::vector<double>* _column;
+        int _id;
+
+      public:
+        m2_event_field()
+        {
+            _column = NULL;
+            _id = -1;
+        }
+
+        void bind(std::vector<double>* column, int id)
+        {
+            _column = column;
+            _id = id;
+        }
+
+        operator double() const
+        {
+            return (*_column)[_id];
+        }
+
+        m2_event_field& operator=(double v)
+        {
+            (*_column)[_id] = v;
+            return *this;
+        }
+
+        m2_event_field& operator=(const m2_event_field& f)
+        {
+            (*_column)[_id] = (double)f;
+            return *this;
+        }
+
+        m2_event_field& operator+=(double v)
+        {
+            (*_column)[_id] += v;
+            return *this;
+        }
+
+        m2_event_field& operator-=(double v)
+        {
+            (*_column)[_id] -= v;
+            return *this;
+        }
+    };
+
+    extern m2_event_table event_table;
+
+} // end namespace m2_core
+
+#endif
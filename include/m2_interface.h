@@ -5,15 +5,82 @@
 #define M2_INTERFACE_H
 
 #include "m2_base.h"
+#include "m2_event.h"
+#include <assert.h>
 
 
 namespace m2_core { // begin namespace m2_core 
 
+    //******************************************************************************
+    // Dense process indices
+    //******************************************************************************
+    // Every process calling a MetroII interface method gets a small index on its
+    // first call. The methods keep their begin/end events in vectors indexed by
+    // it instead of maps keyed by the process handle. The indices are kept in a
+    // vector indexed by the SystemC process ID, so a lookup is a single load.
+    class m2_process_table
+    {
+      private:
+        std::vector<int> _index;    // by sc_process_b::proc_id, -1 if not seen
+        int _no_process;            // index of the invalid handle, -1 if not seen
+        int _size;
+
+      public:
+        m2_process_table()
+        {
+            _no_process = -1;
+            _size = 0;
+        }
+
+        // not thread-safe: only called on the simulation thread, the phase 3
+        // cluster threads find the indices in the slots of their schedulers
+        int index_of(const sc_process_handle& thread)
+        {
+            assert(!m2_event::deferring());
+            sc_process_b* p = (sc_process_b*) thread;
+            if (p == NULL)
+            {
+                if (_no_process < 0)
+                    _no_process = _size++;
+                return _no_process;
+            }
+            unsigned id = p->proc_id;
+            if (id >= _index.size())
+                _index.resize(id + 1, -1);
+            if (_index[id] < 0)
+                _index[id] = _size++;
+            return _index[id];
+        }
+
+        int size()
+        {
+            return _size;
+        }
+    };
+
+    extern m2_process_table process_table;
+
+    extern m2_pool<event_pair_t> event_pair_pool;
+
     //******************************************************************************
     // MetroII interface base class
     //******************************************************************************
+    // The interface owns the begin/end event pairs of its methods and the maps
+    // of __m2_func_event_map. They are released by m2_start once sc_start has
+    // returned (release_all), not by the destructor, which may run after the
+    // manager and the event table are gone.
     class m2_interface 
     {
+      private:
+        std::vector<event_pair_t *> __m2_event_pairs;
+        std::vector<std::vector<event_pair_t *> *> __m2_slot_lists;    // cleared on release
+
+        static std::vector<m2_interface *>& registry()
+        {
+            static std::vector<m2_interface *> interfaces;
+            return interfaces;
+        }
+
       public:
         func_event_map_t __m2_func_event_map;
         m2_interface * __connected_obj;
@@ -22,9 +89,47 @@ namespace m2_core { // begin namespace m2_core
         m2_interface()
         {
             __connected_obj = NULL;
+            registry().push_back(this);
+        }
+
+        virtual ~m2_interface()
+        {
+            std::vector<m2_interface *>& interfaces = registry();
+            interfaces.erase(std::remove(interfaces.begin(), interfaces.end(), this), interfaces.end());
         }
 
-        virtual ~m2_interface() {}
+        // deletes the events of the methods and the maps; the events must not
+        // be used afterwards, a method called again creates new ones
+        void release_events()
+        {
+            for (unsigned i = 0; i < __m2_event_pairs.size(); i++)
+            {
+                delete __m2_event_pairs[i]->first;
+                delete __m2_event_pairs[i]->second;
+                event_pair_pool.destroy(__m2_event_pairs[i]);
+            }
+            __m2_event_pairs.clear();
+            for (unsigned i = 0; i < __m2_slot_lists.size(); i++)
+            {
+                __m2_slot_lists[i]->clear();
+            }
+            __m2_slot_lists.clear();
+            for (func_event_map_t::iterator it = __m2_func_event_map.begin(); it != __m2_func_event_map.end(); it++)
+            {
+                delete it->second;
+            }
+            __m2_func_event_map.clear();
+        }
+
+        // release_events of every interface, called by m2_start
+        static void release_all()
+        {
+            std::vector<m2_interface *>& interfaces = registry();
+            for (unsigned i = 0; i < interfaces.size(); i++)
+            {
+                interfaces[i]->release_events();
+            }
+        }
 
         void connect(m2_interface * dest) 
         {
@@ -36,6 +141,53 @@ namespace m2_core { // begin namespace m2_core
             return __connected_obj;
         }
 
+        // begin/end events of method name for the given process, slots is the
+        // per-method vector indexed by process index (see M2_EVENT_ACCESSOR)
+        event_pair_t* get_event_pair(std::vector<event_pair_t *>& slots, const char* name, 
+                const char* event_name, const sc_process_handle& thread)
+        {
+            unsigned p = process_table.index_of(thread);
+            if ((p < slots.size()) && (slots[p] != NULL))
+            {
+                return slots[p];
+            }
+            return create_event_pair(slots, p, name, event_name, thread);
+        }
+
+        event_pair_t* create_event_pair(std::vector<event_pair_t *>& slots, unsigned p, 
+                const char* name, const char* event_name, const sc_process_handle& thread)
+        {
+            if (event_name == NULL) {
+                event_name = name;
+            }
+            event_pair_t* ep = event_pair_pool.create(new m2_event(name_arena.intern(event_name, "_b"), M2_EVENT_BEGIN),
+                    new m2_event(name_arena.intern(event_name, "_e"), M2_EVENT_END));
+            ep->first->set_partner(ep->second);
+            ep->second->set_partner(ep->first);
+            __m2_event_pairs.push_back(ep);
+
+            if (slots.empty())
+            {
+                __m2_slot_lists.push_back(&slots);
+            }
+            if (slots.size() <= p)
+            {
+                slots.resize(p + 1, NULL);
+            }
+            slots[p] = ep;
+
+            // the map is kept for code that looks the events up by name
+            thread_event_map_t* temap;
+            if (__m2_func_event_map.find(name) == __m2_func_event_map.end()) {
+                temap = new thread_event_map_t;
+                __m2_func_event_map[name] = temap;
+            } else {
+                temap = __m2_func_event_map[name];
+            }
+            (*temap)[thread] = ep;
+            return ep;
+        }
+
     };
 
 } // end namespace m2_core
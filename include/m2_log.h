@@ -0,0 +1,397 @@
+// Trace logger with run time levels per subsystem: records are stored in
+// binary form in a preallocated ring buffer and formatted later
+
+#ifndef M2_LOG_H
+#define M2_LOG_H
+
+#include "m2_base.h"
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// log a printf-like message if the level of the subsystem is at least level;
+// string arguments must stay valid until the record is written (literals,
+// event and process names)
+#define M2_LOG(subsystem, level, format, ...) \
+    do { \
+        if (m2_core::m2_log.enabled(subsystem, level)) \
+            m2_core::m2_log.log(subsystem, level, format, ##__VA_ARGS__); \
+    } while (0)
+
+// maximum number of arguments of a record
+#define M2_LOG_MAX_ARGS 6
+
+namespace m2_core { // begin namespace m2_core
+
+    enum M2_Log_Subsystem
+    {
+        M2_LOG_CORE,        // m2_start, symbol table
+        M2_LOG_MANAGER,
+        M2_LOG_SCHED,
+        M2_LOG_CONSTRAINT,
+        M2_LOG_ANNOTATION,
+        M2_LOG_ADAPTOR,
+        M2_NUM_LOG_SUBSYSTEMS
+    };
+
+    enum M2_Log_Level
+    {
+        M2_LOG_OFF = 0,
+        M2_LOG_INFO = 1,
+        M2_LOG_DEBUG = 2,
+        M2_LOG_TRACE = 3
+    };
+
+    //******************************************************************************
+    // Trace logger
+    //******************************************************************************
+    // A record keeps the format string and up to M2_LOG_MAX_ARGS arguments.
+    // Producers reserve a cell of the ring buffer with a compare and swap
+    // (any thread can log); records are formatted, in order, by the writer
+    // thread when it is started, otherwise when the buffer is full and by
+    // flush_if_idle(), which the manager calls at the end of every
+    // iteration, so that the records stay in order with the output of the
+    // components. Levels are
+    // set with set_level or configure("sched=1,manager=2,..."), m2_start
+    // reads the M2_LOG environment variable.
+    class m2_logger
+    {
+      private:
+        enum arg_type { ARG_LONG, ARG_ULONG, ARG_DOUBLE, ARG_STRING };
+
+        struct record
+        {
+            std::atomic<unsigned long> sequence;
+            const char* format;
+            int nargs;
+            char types[M2_LOG_MAX_ARGS];
+            union
+            {
+                long l;
+                unsigned long u;
+                double d;
+                const char* s;
+            } args[M2_LOG_MAX_ARGS];
+        };
+
+        char _levels[M2_NUM_LOG_SUBSYSTEMS];
+        record* _records;
+        unsigned long _mask;                    // capacity - 1
+        std::atomic<unsigned long> _head;       // next cell to reserve
+        unsigned long _tail;                    // next cell to format
+        std::mutex _consumer;
+        FILE* _out;
+
+        std::thread _writer;
+        std::mutex _writer_mutex;
+        std::condition_variable _writer_wake;
+        bool _writer_stop;
+
+        void set_arg(record& r, int i, long v) { r.types[i] = ARG_LONG; r.args[i].l = v; }
+        void set_arg(record& r, int i, int v) { set_arg(r, i, (long)v); }
+        void set_arg(record& r, int i, short v) { set_arg(r, i, (long)v); }
+        void set_arg(record& r, int i, char v) { set_arg(r, i, (long)v); }
+        void set_arg(record& r, int i, bool v) { set_arg(r, i, (long)v); }
+        void set_arg(record& r, int i, long long v) { set_arg(r, i, (long)v); }
+        void set_arg(record& r, int i, unsigned long v) { r.types[i] = ARG_ULONG; r.args[i].u = v; }
+        void set_arg(record& r, int i, unsigned int v) { set_arg(r, i, (unsigned long)v); }
+        void set_arg(record& r, int i, unsigned long long v) { set_arg(r, i, (unsigned long)v); }
+        void set_arg(record& r, int i, double v) { r.types[i] = ARG_DOUBLE; r.args[i].d = v; }
+        void set_arg(record& r, int i, float v) { set_arg(r, i, (double)v); }
+        void set_arg(record& r, int i, const char* v) { r.types[i] = ARG_STRING; r.args[i].s = v; }
+
+        void set_args(record& r, int i) {}
+
+        template <typename T, typename... Args>
+            void set_args(record& r, int i, T v, Args... args)
+        {
+            set_arg(r, i, v);
+            set_args(r, i + 1, args...);
+        }
+
+        // reserve the next cell, NULL if the buffer is full
+        record* reserve()
+        {
+            unsigned long pos = _head.load(std::memory_order_relaxed);
+            while (true)
+            {
+                record* r = &_records[pos & _mask];
+                unsigned long sequence = r->sequence.load(std::memory_order_acquire);
+                long diff = (long)sequence - (long)pos;
+                if (diff == 0)
+                {
+                    if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        return r;
+                }
+                else if (diff < 0)
+                    return NULL;
+                else
+                    pos = _head.load(std::memory_order_relaxed);
+            }
+        }
+
+        void format(record& r)
+        {
+            char line[1024];
+            char spec[64];
+            int length = 0;
+            int arg = 0;
+            const char* f = r.format;
+
+            while ((*f != 0) && (length < (int)sizeof(line) - 1))
+            {
+                if ((*f != '%') || (f[1] == '%'))
+                {
+                    line[length++] = *f;
+                    f += (*f == '%') ? 2 : 1;
+                    continue;
+                }
+
+                // flags, width and precision are kept, a '*' is replaced by
+                // its (integer) argument; the length modifier comes from the
+                // type of the argument
+                int n = 0;
+                bool valid = true;
+                spec[n++] = *f++;
+                while ((*f != 0) && strchr("-+ #0123456789.*", *f) && (n < 32))
+                {
+                    if (*f != '*')
+                    {
+                        spec[n++] = *f++;
+                        continue;
+                    }
+                    f++;
+                    if ((arg >= r.nargs) || ((r.types[arg] != ARG_LONG) && (r.types[arg] != ARG_ULONG)))
+                    {
+                        valid = false;
+                        break;
+                    }
+                    n += snprintf(spec + n, 12, "%d", (int)r.args[arg].l);
+                    arg++;
+                }
+                while ((*f != 0) && strchr("hlLqjzt", *f))
+                    f++;
+                char conversion = *f;
+                if (conversion != 0)
+                    f++;
+                if (!valid || (arg >= r.nargs))
+                    break;
+
+                int room = sizeof(line) - length;
+                switch (r.types[arg])
+                {
+                  case ARG_LONG:
+                    spec[n++] = 'l'; spec[n++] = conversion; spec[n] = 0;
+                    length += snprintf(line + length, room, spec, r.args[arg].l);
+                    break;
+                  case ARG_ULONG:
+                    spec[n++] = 'l'; spec[n++] = conversion; spec[n] = 0;
+                    length += snprintf(line + length, room, spec, r.args[arg].u);
+                    break;
+                  case ARG_DOUBLE:
+                    spec[n++] = conversion; spec[n] = 0;
+                    length += snprintf(line + length, room, spec, r.args[arg].d);
+                    break;
+                  case ARG_STRING:
+                    spec[n++] = 's'; spec[n] = 0;
+                    length += snprintf(line + length, room, spec, r.args[arg].s);
+                    break;
+                }
+                length = std::min(length, (int)sizeof(line) - 1);
+                arg++;
+            }
+            line[length++] = '\n';
+            fwrite(line, 1, length, _out);
+        }
+
+        // format the records reserved so far, the caller holds _consumer
+        void drain()
+        {
+            while (true)
+            {
+                record& r = _records[_tail & _mask];
+                if (r.sequence.load(std::memory_order_acquire) != _tail + 1)
+                    break;
+                format(r);
+                r.sequence.store(_tail + _mask + 1, std::memory_order_release);
+                _tail++;
+            }
+        }
+
+        void write_loop()
+        {
+            std::unique_lock<std::mutex> lock(_writer_mutex);
+            while (!_writer_stop)
+            {
+                _writer_wake.wait_for(lock, std::chrono::milliseconds(1));
+                flush(false);
+            }
+        }
+
+      public:
+        // capacity is rounded up to a power of 2
+        m2_logger(int capacity = 1 << 14)
+        {
+            unsigned long size = 1;
+            while (size < (unsigned long)capacity)
+                size <<= 1;
+            _records = new record[size];
+            for (unsigned long i = 0; i < size; i++)
+            {
+                _records[i].sequence.store(i, std::memory_order_relaxed);
+            }
+            _mask = size - 1;
+            _head = 0;
+            _tail = 0;
+            _out = stdout;
+            _writer_stop = false;
+
+            for (int i = 0; i < M2_NUM_LOG_SUBSYSTEMS; i++)
+            {
+                _levels[i] = M2_LOG_INFO;
+            }
+        }
+
+        ~m2_logger()
+        {
+            stop_writer();
+            flush();
+            delete [] _records;
+        }
+
+        bool enabled(M2_Log_Subsystem subsystem, int level)
+        {
+            return _levels[subsystem] >= level;
+        }
+
+        void set_level(M2_Log_Subsystem subsystem, int level)
+        {
+            _levels[subsystem] = level;
+        }
+
+        void set_level(int level)
+        {
+            for (int i = 0; i < M2_NUM_LOG_SUBSYSTEMS; i++)
+            {
+                _levels[i] = level;
+            }
+        }
+
+        int get_level(M2_Log_Subsystem subsystem)
+        {
+            return _levels[subsystem];
+        }
+
+        void set_output(FILE* out)
+        {
+            flush();
+            _out = out;
+        }
+
+        // comma separated subsystem=level items, with subsystem one of core,
+        // manager, sched, constraint, annotation, adaptor or all; the item
+        // "writer" starts the writer thread
+        void configure(const char* spec)
+        {
+            static const char* names[M2_NUM_LOG_SUBSYSTEMS] = {
+                "core", "manager", "sched", "constraint", "annotation", "adaptor"
+            };
+
+            while ((spec != NULL) && (*spec != 0))
+            {
+                const char* end = strchr(spec, ',');
+                int length = (end != NULL) ? end - spec : strlen(spec);
+                const char* equal = (const char*)memchr(spec, '=', length);
+                int name_length = (equal != NULL) ? equal - spec : length;
+
+                if ((name_length == 6) && (strncmp(spec, "writer", 6) == 0))
+                {
+                    start_writer();
+                }
+                else if (equal != NULL)
+                {
+                    int level = atoi(equal + 1);
+                    if ((name_length == 3) && (strncmp(spec, "all", 3) == 0))
+                        set_level(level);
+                    for (int i = 0; i < M2_NUM_LOG_SUBSYSTEMS; i++)
+                    {
+                        if (((int)strlen(names[i]) == name_length) && (strncmp(spec, names[i], name_length) == 0))
+                            set_level((M2_Log_Subsystem)i, level);
+                    }
+                }
+                spec = (end != NULL) ? end + 1 : NULL;
+            }
+        }
+
+        template <typename... Args>
+            void log(M2_Log_Subsystem subsystem, int level, const char* format, Args... args)
+        {
+            static_assert(sizeof...(Args) <= M2_LOG_MAX_ARGS, "too many arguments for M2_LOG");
+
+            record* r;
+            while ((r = reserve()) == NULL)
+            {
+                // full: format the pending records, or wait for whoever does
+                if (_consumer.try_lock())
+                {
+                    drain();
+                    _consumer.unlock();
+                }
+                else {
+                    std::this_thread::yield();
+                }
+            }
+            r->format = format;
+            r->nargs = sizeof...(Args);
+            set_args(*r, 0, args...);
+            r->sequence.store(r->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        // format the pending records
+        void flush(bool sync = true)
+        {
+            std::lock_guard<std::mutex> lock(_consumer);
+            drain();
+            if (sync)
+                fflush(_out);
+        }
+
+        // format the pending records unless the writer thread does; stdout
+        // is not flushed, the records go to its buffer after the output
+        // printed before them
+        void flush_if_idle()
+        {
+            if (!_writer.joinable())
+                flush(false);
+        }
+
+        void start_writer()
+        {
+            if (_writer.joinable())
+                return;
+            _writer_stop = false;
+            _writer = std::thread(&m2_logger::write_loop, this);
+        }
+
+        void stop_writer()
+        {
+            if (!_writer.joinable())
+                return;
+            {
+                std::lock_guard<std::mutex> lock(_writer_mutex);
+                _writer_stop = true;
+            }
+            _writer_wake.notify_one();
+            _writer.join();
+        }
+    };
+
+    extern m2_logger m2_log;
+
+} // end namespace m2_core
+
+#endif
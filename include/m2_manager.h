@@ -9,12 +9,15 @@
 //******************************************************************************
 #include "m2_base.h"
 #include "m2_debug.h"
+#include "m2_log.h"
 #include "m2_event.h"
 #include "m2_component.h"
 #include "m2_interface.h"
 #include "m2_ports.h"
 #include "m2_constraints.h"
 #include "m2_ann_sched.h"
+#include "m2_stats.h"
+#include "m2_cluster.h"
 
 namespace m2_core { //begin namespace m2_core 
 
@@ -24,6 +27,8 @@ namespace m2_core { //begin namespace m2_core
     // does not handle multiple proposed events per process and terminating processes
     class m2_manager : public sc_module 
     {
+        // proposed events that are not yet enabled, each event stores its own
+        // position so that it can be removed in constant time
         std::vector <m2_event *> events; 
 
         int procs_ready_to_switch;
@@ -31,6 +36,13 @@ namespace m2_core { //begin namespace m2_core
         int total_adaptors;
         sc_event e_activate_manager;
 
+        m2_phase_stats stats;
+        m2_annotation_runner annotation_runner;
+        m2_batch_dispatcher batch_dispatcher;
+        int phase3_threads;
+        bool clustered;             // phase 3 runs on clusters
+        m2_cluster_set clusters;
+
       public:
 
         m2_constraint_solver* c_solver;
@@ -43,6 +55,8 @@ namespace m2_core { //begin namespace m2_core
         {
             procs_ready_to_switch = 0;
             total_adaptors = 0;
+            phase3_threads = 1;
+            clustered = false;
 
             c_solver = new m2_constraint_solver();
 
@@ -73,13 +87,33 @@ namespace m2_core { //begin namespace m2_core
 
             M2_DEBUG2("Propose Event: " << e.get_full_name());
             e.set_status(M2_EVENT_PROPOSED);
-            events.push_back(&e);
+            e.mark_dirty();
+            add_pending_event(&e);
             increment_procs_ready_to_switch();
             wait(e);
 
 #endif
         }
 
+        void add_pending_event(m2_event* e)
+        {
+            if (!e->is_pending())
+            {
+                e->set_pending_index(events.size());
+                events.push_back(e);
+            }
+        }
+
+        void remove_pending_event(m2_event* e)
+        {
+            int index = e->get_pending_index();
+            m2_event* last = events.back();
+            events[index] = last;
+            last->set_pending_index(index);
+            events.pop_back();
+            e->set_pending_index(-1);
+        }
+
         void increment_procs_ready_to_switch()
         {
 #if SWITCH_PHASES == 1
@@ -105,7 +139,7 @@ namespace m2_core { //begin namespace m2_core
         void decrement_total_procs()
         {
             total_procs--;
-            cout << "Total processes " << total_procs << endl;
+            M2_LOG(M2_LOG_MANAGER, M2_LOG_INFO, "Total processes %d", total_procs);
             if (total_procs == total_adaptors)
                 sc_stop();
             M2_DEBUG2("Total procs decremented to " << total_procs);
@@ -126,19 +160,78 @@ namespace m2_core { //begin namespace m2_core
             c_solver = _c_solver; 
         }
 
+        // called by m2_start once the design is built, before the simulation starts
+        void elaborate()
+        {
+            for (unsigned i = 0; i < annotator_list.size(); i++)
+            {
+                annotator_list[i]->elaborate();
+            }
+            batch_dispatcher.elaborate(annotator_list);
+            for (unsigned i = 0; i < scheduler_list.size(); i++)
+            {
+                scheduler_list[i]->elaborate();
+            }
+            if (phase3_threads > 1)
+            {
+                clusters.set_threads(phase3_threads);
+                clustered = clusters.build(c_solver, scheduler_list);
+            }
+            if (!clustered)
+            {
+                c_solver->elaborate();
+            }
+        }
+
+        // run phase 3 on independent clusters of constraints and schedulers,
+        // on threads threads (including the simulation thread); set before
+        // m2_start, the constraints and schedulers must not call SystemC and
+        // none can be added (nor events to the schedulers) after m2_start
+        void set_phase3_threads(int threads)
+        {
+            phase3_threads = threads;
+        }
+
+        m2_cluster_set& get_clusters()
+        {
+            return clusters;
+        }
+
         void add_annotator(m2_annotator* _annotator)
         {
             annotator_list.push_back(_annotator);
         }
 
+        // phase 2 on threads threads (including the simulation thread), the
+        // annotators must not call SystemC when run in parallel
+        void set_annotation_mode(M2_Annotation_Mode mode, int threads = 1)
+        {
+            annotation_runner.set_mode(mode, threads);
+        }
+
+        m2_annotation_runner& get_annotation_runner()
+        {
+            return annotation_runner;
+        }
+
         void add_scheduler(m2_scheduler* _scheduler)
         {
             scheduler_list.push_back(_scheduler);
         }
 
+        // per-phase timing and counters, reported by m2_start at the end
+        void enable_stats(bool enabled)
+        {
+            stats.set_enabled(enabled);
+        }
+
+        m2_phase_stats& get_stats()
+        {
+            return stats;
+        }
+
         void main()
         {
-            std::vector<m2_event *> tmp_events;
             while(true)
             {
                 M2_DEBUG1("------------- Start simulation iteration --------------");
@@ -149,19 +242,33 @@ namespace m2_core { //begin namespace m2_core
                 M2_DEBUG1("Phase1: Base Model Execution");
                 wait(e_activate_manager); // wait to switch
 
+                bool timed = stats.enabled();
+                long rounds = 0;
+                long enabled_events = 0;
+                if (timed) stats.end_phase(M2_PHASE_BASE_MODEL);
+
                 // phase 2: annotation
                 M2_DEBUG1("Phase2: Annotation");
-                for (unsigned i = 0; i < annotator_list.size(); i++)
-                    annotator_list[i]->annotate();
+                batch_dispatcher.dispatch(annotator_list, events);
+                annotation_runner.run(annotator_list);
+
+                if (timed) stats.end_phase(M2_PHASE_ANNOTATION);
 
                 // phase 3: constraint resolution
-                bool statusChange = true;
-                std::vector<char> eventStatus;
+                bool statusChange = !clustered;
+                if (clustered)
+                {
+                    if (clusters.stale(c_solver, scheduler_list))
+                        SC_REPORT_ERROR(name(), "constraints, schedulers or scheduler events added after m2_start "
+                                "are not supported with phase 3 threads");
+                    rounds = clusters.resolve(timed ? &stats : NULL);
+                }
                 while (statusChange)
                 {
                     M2_DEBUG3("testing status change...");
 
                     statusChange = false;
+                    rounds++;
 
                     // phase 3: constraint solver
                     M2_DEBUG1("Phase3.1: Constraint Solving");
@@ -172,15 +279,25 @@ namespace m2_core { //begin namespace m2_core
                         statusChange = true;
                     }
 
+                    if (timed) stats.end_phase(M2_PHASE_SOLVING);
+
                     // phase 3: schedulers
+                    // a scheduler using watchers whose events did not change
+                    // since its last call is stable, it is not called again
                     M2_DEBUG1("Phase3.2: Scheduling");
                     for (unsigned i = 0; i < scheduler_list.size(); i++) {
+                        if (!scheduler_list[i]->touched())
+                            continue;
+                        // changes made by the scheduler itself touch it again
+                        scheduler_list[i]->clear_touched();
                         scheduler_list[i]->schedule();
                         if (!scheduler_list[i]->is_stable())
                         {
                             statusChange = true;
                         }
                     }					
+
+                    if (timed) stats.end_phase(M2_PHASE_SCHEDULING);
                 }
 
                 // post_schedule of the schedulers
@@ -190,29 +307,47 @@ namespace m2_core { //begin namespace m2_core
                 
                 // post_resolve of the solvers should be after schedulers if for instance
                 // the time annotation need to be passed between sync. events
-                c_solver->post_resolve();
+                if (clustered)
+                    clusters.post_resolve();
+                else
+                    c_solver->post_resolve();
+
+                if (timed) stats.end_phase(M2_PHASE_POST);
 
                 // phase 3: enable/disable events
+                // a pending event can only be proposed at this point if its status
+                // changed during this iteration, so only the dirty events are visited
                 M2_DEBUG1("Phase3.3: Enable/disable events");
-                tmp_events.clear();
 
-                M2_DEBUG3("# of events after phases: " << events.size());
+                std::vector<m2_event *>& dirty_events = m2_event::get_dirty_events();
+
+                M2_DEBUG3("# of events after phases: " << events.size() << ", changed: " << dirty_events.size());
 
-                for (unsigned i = 0; i < events.size(); i++)
+                for (unsigned i = 0; i < dirty_events.size(); i++)
                 {
-                    if (events[i]->get_status() == (char)M2_EVENT_PROPOSED) {
-                        events[i]->set_status((char)M2_EVENT_INACTIVE);
-                        events[i]->notify(SC_ZERO_TIME);
+                    m2_event* e = dirty_events[i];
+                    if ((e == NULL) || !e->is_pending())
+                        continue;
+
+                    if (e->get_status() == (char)M2_EVENT_PROPOSED) {
+                        e->set_status((char)M2_EVENT_INACTIVE);
+                        e->notify(SC_ZERO_TIME);
+                        remove_pending_event(e);
                         procs_ready_to_switch--;
+                        enabled_events++;
                     }
-                    else {
-                        tmp_events.push_back(events[i]);
-                    }
-                    M2_DEBUG2("event " << events[i]->get_full_name() << " status " << events[i]->string_status());
+                    M2_DEBUG2("event " << e->get_full_name() << " status " << e->string_status());
                 }
 
-                events.clear();
-                events = tmp_events;
+                m2_event::clear_dirty_events();
+
+                if (timed)
+                {
+                    stats.end_phase(M2_PHASE_ENABLE);
+                    stats.end_iteration(rounds, enabled_events);
+                }
+
+                m2_log.flush_if_idle();
 
                 M2_DEBUG1("------------- End simulation iteration --------------");
             }
@@ -233,14 +368,12 @@ namespace m2_core { //begin namespace m2_core
     (req_obj).req_port.connect((typeof ((req_obj).req_port.getThisInterface())) &(prov_obj)); \
     (prov_obj).prov_port.connect((typeof ((prov_obj).prov_port.getThisInterface())) &(req_obj));
 
-    //Limitation:
-    //      1. restrict to single function argument and single return value
-    //      2. cannot use void as return value
-    //
-    // Possible solutions to the M2_FUNCTION macro that may solve limitation 1.
-    //#define M2_FUNCTION(return_type, name, ...) name(__VA_ARGS__)
-    //#define M2_FUNCTION(return_type, name, argument_type ...) name(argument_type)
-    // limitation 2 is still open
+    // Wrappers of interface methods: M2_METHOD(return_type, name, argument types...)
+    // and M2_PROCEDURE(name, argument types...) declare a method that proposes
+    // its begin event, forwards the call to the connected object and proposes
+    // its end event. Up to 8 arguments, argument types cannot contain commas.
+    // The *_EVENT variants copy tag, val and status of the begin event to the
+    // end event once the call returns.
 
 #define make_string(s) #s
 
@@ -260,88 +393,95 @@ namespace m2_core { //begin namespace m2_core
     mapping_constraints->addConstraint(func_component##func_event_beg##arch_component##arch_event_beg);\
     mapping_constraints->addConstraint(func_component##func_event_end##arch_component##arch_event_end);
 
-#define M2_NOARG_FUNCTION(return_type, name) \
-    virtual return_type name() { \
-        return_type __ret; \
-        manager.propose_events(name(M2_EVENT_BEGIN)); \
-        if (get_connected_obj()) __ret = ((typeof this)get_connected_obj())->name(); \
-        else __ret = 0;\
-        manager.propose_events(name(M2_EVENT_END)); \
-        return __ret; \
-    }; \
+// maps the begin and end events of a function and an architecture method
+// through a rendezvous group instead of two pairwise mapping constraints
+#define M2_MAP_GROUP(group, func_component, func_method, arch_component, arch_method) \
+    (group)->add(func_component.func_method##_event_beg, arch_component.arch_method##_event_beg);\
+    (group)->add(func_component.func_method##_event_end, arch_component.arch_method##_event_end);
+
+// event accessor shared by the wrappers below: the begin/end events of the
+// method are created on the first call of each process and then found in
+// the process slot of __m2_<name>_slots
+#define M2_EVENT_ACCESSOR(name) \
+    std::vector<event_pair_t *> __m2_##name##_slots; \
+    \
+    event_pair_t* __m2_##name##_events(char* event_name = NULL, sc_process_handle thread = \
+            sc_get_current_process_handle()) { \
+        return get_event_pair(__m2_##name##_slots, #name, event_name, thread); \
+    } \
     \
     virtual m2_event& name(M2_Event_Types _type, char* event_name = NULL, sc_process_handle thread = \
             sc_get_current_process_handle()) { \
-        thread_event_map_t* temap; \
-        if (__m2_func_event_map.find(#name) == __m2_func_event_map.end()) { \
-            temap = new thread_event_map_t; \
-            __m2_func_event_map[#name] = temap; \
-        } else { \
-            temap = __m2_func_event_map[#name]; \
-        } \
-        event_pair_t * ep; \
-        if (temap->find(thread) == temap->end()) { \
-	    char* event_beg_name; \
-	    char* event_end_name; \
-	    if (event_name != NULL) { \
-		    STR_CAT(event_beg_name, event_name, "_b"); \
-		    STR_CAT(event_end_name, event_name, "_e"); \
-            } \
-	    else { \
-		    STR_CAT(event_beg_name, #name, "_b"); \
-		    STR_CAT(event_end_name, #name, "_e"); \
-            } \
-            ep = new event_pair_t(new m2_event(event_beg_name), \
-                    new m2_event(event_end_name));\
-            (*temap)[thread] = ep; \
-        } else { \
-            ep = (*temap)[thread]; \
-        } \
+        event_pair_t* ep = __m2_##name##_events(event_name, thread); \
         return (_type == M2_EVENT_BEGIN)? \
         *(ep->first) : *(ep->second); \
     };
 
-#define M2_ONEARG_FUNCTION(return_type, name, argument_type1) \
-    virtual return_type name(argument_type1 __arg1) { \
-        return_type __ret; \
-        manager.propose_events(name(M2_EVENT_BEGIN)); \
-        if (get_connected_obj()) __ret = ((typeof this)get_connected_obj())->name(__arg1); \
-        else __ret = 0;\
-        manager.propose_events(name(M2_EVENT_END)); \
-        return __ret; \
+// argument lists of the wrappers: M2_PARAMS(t1, t2) is "t1 __arg1, t2 __arg2"
+// and M2_ARGS(t1, t2) forwards __arg1 and __arg2
+#define M2_NARGS(...) M2_NARGS_(0, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define M2_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, n, ...) n
+#define M2_CAT(a, b) M2_CAT_(a, b)
+#define M2_CAT_(a, b) a##b
+
+#define M2_PARAMS(...) M2_CAT(M2_PARAMS_, M2_NARGS(__VA_ARGS__))(__VA_ARGS__)
+#define M2_PARAMS_0()
+#define M2_PARAMS_1(t1) t1 __arg1
+#define M2_PARAMS_2(t1, t2) M2_PARAMS_1(t1), t2 __arg2
+#define M2_PARAMS_3(t1, t2, t3) M2_PARAMS_2(t1, t2), t3 __arg3
+#define M2_PARAMS_4(t1, t2, t3, t4) M2_PARAMS_3(t1, t2, t3), t4 __arg4
+#define M2_PARAMS_5(t1, t2, t3, t4, t5) M2_PARAMS_4(t1, t2, t3, t4), t5 __arg5
+#define M2_PARAMS_6(t1, t2, t3, t4, t5, t6) M2_PARAMS_5(t1, t2, t3, t4, t5), t6 __arg6
+#define M2_PARAMS_7(t1, t2, t3, t4, t5, t6, t7) M2_PARAMS_6(t1, t2, t3, t4, t5, t6), t7 __arg7
+#define M2_PARAMS_8(t1, t2, t3, t4, t5, t6, t7, t8) M2_PARAMS_7(t1, t2, t3, t4, t5, t6, t7), t8 __arg8
+
+#define M2_ARGS(...) M2_CAT(M2_ARGS_, M2_NARGS(__VA_ARGS__))(__VA_ARGS__)
+#define M2_ARGS_0()
+#define M2_ARGS_1(t1) std::forward<t1>(__arg1)
+#define M2_ARGS_2(t1, t2) M2_ARGS_1(t1), std::forward<t2>(__arg2)
+#define M2_ARGS_3(t1, t2, t3) M2_ARGS_2(t1, t2), std::forward<t3>(__arg3)
+#define M2_ARGS_4(t1, t2, t3, t4) M2_ARGS_3(t1, t2, t3), std::forward<t4>(__arg4)
+#define M2_ARGS_5(t1, t2, t3, t4, t5) M2_ARGS_4(t1, t2, t3, t4), std::forward<t5>(__arg5)
+#define M2_ARGS_6(t1, t2, t3, t4, t5, t6) M2_ARGS_5(t1, t2, t3, t4, t5), std::forward<t6>(__arg6)
+#define M2_ARGS_7(t1, t2, t3, t4, t5, t6, t7) M2_ARGS_6(t1, t2, t3, t4, t5, t6), std::forward<t7>(__arg7)
+#define M2_ARGS_8(t1, t2, t3, t4, t5, t6, t7, t8) M2_ARGS_7(t1, t2, t3, t4, t5, t6, t7), std::forward<t8>(__arg8)
+
+// forwards the call to the connected object, an unconnected method returns
+// a value-initialized return_type
+#define M2_FORWARD(return_type, name, ...) \
+    [&]() -> return_type { \
+        if (get_connected_obj()) \
+            return ((typeof this)get_connected_obj())->name(__VA_ARGS__); \
+        return m2_invoke<return_type>::unconnected(); \
+    }
+
+#define M2_METHOD(return_type, name, ...) \
+    virtual return_type name(M2_PARAMS(__VA_ARGS__)) { \
+        return m2_invoke<return_type>::call(__m2_##name##_events(), \
+                M2_FORWARD(return_type, name, M2_ARGS(__VA_ARGS__))); \
     }; \
     \
-    virtual m2_event& name(M2_Event_Types _type, char* event_name = NULL, sc_process_handle thread = \
-            sc_get_current_process_handle()) { \
-        thread_event_map_t* temap; \
-        if (__m2_func_event_map.find(#name) == __m2_func_event_map.end()) { \
-            temap = new thread_event_map_t; \
-            __m2_func_event_map[#name] = temap; \
-        } else { \
-            temap = __m2_func_event_map[#name]; \
-        } \
-        event_pair_t * ep; \
-        if (temap->find(thread) == temap->end()) { \
-	    char* event_beg_name; \
-	    char* event_end_name; \
-	    if (event_name != NULL) { \
-		    STR_CAT(event_beg_name, event_name, "_b"); \
-		    STR_CAT(event_end_name, event_name, "_e"); \
-            } \
-	    else { \
-		    STR_CAT(event_beg_name, #name, "_b"); \
-		    STR_CAT(event_end_name, #name, "_e"); \
-            } \
-            ep = new event_pair_t(new m2_event(event_beg_name), \
-                    new m2_event(event_end_name));\
-            (*temap)[thread] = ep; \
-        } else { \
-            ep = (*temap)[thread]; \
-        } \
-        return (_type == M2_EVENT_BEGIN)? \
-        *(ep->first) : *(ep->second); \
-    };
-	
+    M2_EVENT_ACCESSOR(name)
+
+#define M2_METHOD_EVENT(return_type, name, ...) \
+    virtual return_type name(M2_PARAMS(__VA_ARGS__)) { \
+        return m2_invoke<return_type>::call_passing_info(__m2_##name##_events(), \
+                M2_FORWARD(return_type, name, M2_ARGS(__VA_ARGS__))); \
+    }; \
+    \
+    M2_EVENT_ACCESSOR(name)
+
+#define M2_PROCEDURE(name, ...) M2_METHOD(void, name, ##__VA_ARGS__)
+#define M2_PROCEDURE_EVENT(name, ...) M2_METHOD_EVENT(void, name, ##__VA_ARGS__)
+
+// fixed arity versions, kept for existing models
+
+#define M2_NOARG_FUNCTION(return_type, name) \
+    M2_METHOD(return_type, name)
+
+#define M2_ONEARG_FUNCTION(return_type, name, argument_type1) \
+    M2_METHOD(return_type, name, argument_type1)
+
 //this is a function with unlimited number of passed arguments with one mandatory type element of type	argument_type1
 #define M2_FUNCTION(return_type, name, argument_type1, ...) \
     virtual return_type name(argument_type1 __arg1, ...) { \
@@ -353,319 +493,35 @@ namespace m2_core { //begin namespace m2_core
         return __ret; \
     }; \
     \
-	virtual return_type name(argument_type1 __arg1, va_list & listPointer) { \
-        return_type __ret; \
-        manager.propose_events(name(M2_EVENT_BEGIN)); \
-		\
-        if (get_connected_obj()) __ret = ((typeof this)get_connected_obj())->name(__arg1, listPointer); \
-        else __ret = 0;\
-		\
-        manager.propose_events(name(M2_EVENT_END)); \
-        return __ret; \
+    virtual return_type name(argument_type1 __arg1, va_list & listPointer) { \
+        return m2_invoke<return_type>::call(__m2_##name##_events(), \
+                M2_FORWARD(return_type, name, __arg1, listPointer)); \
     }; \
     \
-    virtual m2_event& name(M2_Event_Types _type, char* event_name = NULL, sc_process_handle thread = \
-            sc_get_current_process_handle()) { \
-        thread_event_map_t* temap; \
-        if (__m2_func_event_map.find(#name) == __m2_func_event_map.end()) { \
-            temap = new thread_event_map_t; \
-            __m2_func_event_map[#name] = temap; \
-        } else { \
-            temap = __m2_func_event_map[#name]; \
-        } \
-        event_pair_t * ep; \
-        if (temap->find(thread) == temap->end()) { \
-	    char* event_beg_name; \
-	    char* event_end_name; \
-	    if (event_name != NULL) { \
-		    STR_CAT(event_beg_name, event_name, "_b"); \
-		    STR_CAT(event_end_name, event_name, "_e"); \
-            } \
-	    else { \
-		    STR_CAT(event_beg_name, #name, "_b"); \
-		    STR_CAT(event_end_name, #name, "_e"); \
-            } \
-            ep = new event_pair_t(new m2_event(event_beg_name), \
-                    new m2_event(event_end_name));\
-            (*temap)[thread] = ep; \
-        } else { \
-            ep = (*temap)[thread]; \
-        } \
-        return (_type == M2_EVENT_BEGIN)? \
-        *(ep->first) : *(ep->second); \
-    };	
+    M2_EVENT_ACCESSOR(name)
 
 #define M2_NOARG_PROCEDURE(name) \
-    virtual void name() { \
-        manager.propose_events(name(M2_EVENT_BEGIN)); \
-        if (get_connected_obj()) ((typeof this)get_connected_obj())->name(); \
-        manager.propose_events(name(M2_EVENT_END)); \
-    }; \
-    \
-    virtual m2_event& name(M2_Event_Types _type, char* event_name = NULL, sc_process_handle thread = \
-            sc_get_current_process_handle()) { \
-        thread_event_map_t* temap; \
-        if (__m2_func_event_map.find(#name) == __m2_func_event_map.end()) { \
-            temap = new thread_event_map_t; \
-            __m2_func_event_map[#name] = temap; \
-        } else { \
-            temap = __m2_func_event_map[#name]; \
-        } \
-        event_pair_t * ep; \
-        if (temap->find(thread) == temap->end()) { \
-	    char* event_beg_name; \
-	    char* event_end_name; \
-	    if (event_name != NULL) { \
-		    STR_CAT(event_beg_name, event_name, "_b"); \
-		    STR_CAT(event_end_name, event_name, "_e"); \
-            } \
-	    else { \
-		    STR_CAT(event_beg_name, #name, "_b"); \
-		    STR_CAT(event_end_name, #name, "_e"); \
-            } \
-            ep = new event_pair_t(new m2_event(event_beg_name), \
-                    new m2_event(event_end_name));\
-            (*temap)[thread] = ep; \
-        } else { \
-            ep = (*temap)[thread]; \
-        } \
-        return (_type == M2_EVENT_BEGIN)? \
-        *(ep->first) : *(ep->second); \
-    };
+    M2_PROCEDURE(name)
 
 #define M2_ONEARG_PROCEDURE(name, argument_type1) \
-    virtual void name(argument_type1 __arg1) { \
-        manager.propose_events(name(M2_EVENT_BEGIN)); \
-        if (get_connected_obj()) ((typeof(this))get_connected_obj())->name(__arg1); \
-        manager.propose_events(name(M2_EVENT_END)); \
-    }; \
-    \
-    virtual m2_event& name(M2_Event_Types _type, char* event_name = NULL, sc_process_handle thread = \
-            sc_get_current_process_handle()) { \
-        thread_event_map_t* temap; \
-        if (__m2_func_event_map.find(#name) == __m2_func_event_map.end()) { \
-            temap = new thread_event_map_t; \
-            __m2_func_event_map[#name] = temap; \
-        } else { \
-            temap = __m2_func_event_map[#name]; \
-        } \
-        event_pair_t * ep; \
-        if (temap->find(thread) == temap->end()) { \
-	    char* event_beg_name; \
-	    char* event_end_name; \
-	    if (event_name != NULL) { \
-		    STR_CAT(event_beg_name, event_name, "_b"); \
-		    STR_CAT(event_end_name, event_name, "_e"); \
-            } \
-	    else { \
-		    STR_CAT(event_beg_name, #name, "_b"); \
-		    STR_CAT(event_end_name, #name, "_e"); \
-            } \
-            ep = new event_pair_t(new m2_event(event_beg_name), \
-                    new m2_event(event_end_name));\
-            (*temap)[thread] = ep; \
-        } else { \
-            ep = (*temap)[thread]; \
-        } \
-        return (_type == M2_EVENT_BEGIN)? \
-        *(ep->first) : *(ep->second); \
-    };
+    M2_PROCEDURE(name, argument_type1)
 
 #define M2_TWOARG_PROCEDURE(name, argument_type1, argument_type2) \
-    virtual void name(argument_type1 __arg1, argument_type2 __arg2) { \
-        manager.propose_events(name(M2_EVENT_BEGIN)); \
-        if (get_connected_obj()) ((typeof(this))get_connected_obj())->name(__arg1, __arg2); \
-        manager.propose_events(name(M2_EVENT_END)); \
-    }; \
-    \
-    virtual m2_event& name(M2_Event_Types _type, char* event_name = NULL, sc_process_handle thread = \
-            sc_get_current_process_handle()) { \
-        thread_event_map_t* temap; \
-        if (__m2_func_event_map.find(#name) == __m2_func_event_map.end()) { \
-            temap = new thread_event_map_t; \
-            __m2_func_event_map[#name] = temap; \
-        } else { \
-            temap = __m2_func_event_map[#name]; \
-        } \
-        event_pair_t * ep; \
-        if (temap->find(thread) == temap->end()) { \
-	    char* event_beg_name; \
-	    char* event_end_name; \
-	    if (event_name != NULL) { \
-		    STR_CAT(event_beg_name, event_name, "_b"); \
-		    STR_CAT(event_end_name, event_name, "_e"); \
-            } \
-	    else { \
-		    STR_CAT(event_beg_name, #name, "_b"); \
-		    STR_CAT(event_end_name, #name, "_e"); \
-            } \
-            ep = new event_pair_t(new m2_event(event_beg_name), \
-                    new m2_event(event_end_name));\
-            (*temap)[thread] = ep; \
-        } else { \
-            ep = (*temap)[thread]; \
-        } \
-        return (_type == M2_EVENT_BEGIN)? \
-        *(ep->first) : *(ep->second); \
-    };
+    M2_PROCEDURE(name, argument_type1, argument_type2)
 
     // _EVENT for test, to be remove
 
 #define M2_TWOARG_PROCEDURE_EVENT(name, argument_type1, argument_type2) \
-    virtual void name(argument_type1 __arg1, argument_type2 __arg2) { \
-        manager.propose_events(name(M2_EVENT_BEGIN)); \
-        m2_event_info* tmp = new m2_event_info(name(M2_EVENT_BEGIN));\
-        if (get_connected_obj()) ((typeof(this))get_connected_obj())->name(__arg1, __arg2); \
-        tmp->copy_info_to_event(name(M2_EVENT_END));\
-        manager.propose_events(name(M2_EVENT_END)); \
-    }; \
-    \
-    virtual m2_event& name(M2_Event_Types _type, char* event_name = NULL, sc_process_handle thread = \
-            sc_get_current_process_handle()) { \
-        thread_event_map_t* temap; \
-        if (__m2_func_event_map.find(#name) == __m2_func_event_map.end()) { \
-            temap = new thread_event_map_t; \
-            __m2_func_event_map[#name] = temap; \
-        } else { \
-            temap = __m2_func_event_map[#name]; \
-        } \
-        event_pair_t * ep; \
-        if (temap->find(thread) == temap->end()) { \
-	    char* event_beg_name; \
-	    char* event_end_name; \
-	    if (event_name != NULL) { \
-		    STR_CAT(event_beg_name, event_name, "_b"); \
-		    STR_CAT(event_end_name, event_name, "_e"); \
-            } \
-	    else { \
-		    STR_CAT(event_beg_name, #name, "_b"); \
-		    STR_CAT(event_end_name, #name, "_e"); \
-            } \
-            ep = new event_pair_t(new m2_event(event_beg_name), \
-                    new m2_event(event_end_name));\
-            (*temap)[thread] = ep; \
-        } else { \
-            ep = (*temap)[thread]; \
-        } \
-        return (_type == M2_EVENT_BEGIN)? \
-        *(ep->first) : *(ep->second); \
-    };
+    M2_PROCEDURE_EVENT(name, argument_type1, argument_type2)
 
 #define M2_THREEARG_PROCEDURE(name, argument_type1, argument_type2, argument_type3) \
-    virtual void name(argument_type1 __arg1, argument_type2 __arg2, argument_type3 __arg3) { \
-        manager.propose_events(name(M2_EVENT_BEGIN)); \
-        if (get_connected_obj()) ((typeof(this))get_connected_obj())->name(__arg1, __arg2, __arg3); \
-        manager.propose_events(name(M2_EVENT_END)); \
-    }; \
-    \
-    virtual m2_event& name(M2_Event_Types _type, char* event_name = NULL, sc_process_handle thread = \
-            sc_get_current_process_handle()) { \
-        thread_event_map_t* temap; \
-        if (__m2_func_event_map.find(#name) == __m2_func_event_map.end()) { \
-            temap = new thread_event_map_t; \
-            __m2_func_event_map[#name] = temap; \
-        } else { \
-            temap = __m2_func_event_map[#name]; \
-        } \
-        event_pair_t * ep; \
-        if (temap->find(thread) == temap->end()) { \
-	    char* event_beg_name; \
-	    char* event_end_name; \
-	    if (event_name != NULL) { \
-		    STR_CAT(event_beg_name, event_name, "_b"); \
-		    STR_CAT(event_end_name, event_name, "_e"); \
-            } \
-	    else { \
-		    STR_CAT(event_beg_name, #name, "_b"); \
-		    STR_CAT(event_end_name, #name, "_e"); \
-            } \
-            ep = new event_pair_t(new m2_event(event_beg_name), \
-                    new m2_event(event_end_name));\
-            (*temap)[thread] = ep; \
-        } else { \
-            ep = (*temap)[thread]; \
-        } \
-        return (_type == M2_EVENT_BEGIN)? \
-        *(ep->first) : *(ep->second); \
-    };
+    M2_PROCEDURE(name, argument_type1, argument_type2, argument_type3)
 
 #define M2_THREEARG_PROCEDURE_EVENT(name, argument_type1, argument_type2, argument_type3) \
-    virtual void name(argument_type1 __arg1, argument_type2 __arg2, argument_type3 __arg3) { \
-        manager.propose_events(name(M2_EVENT_BEGIN)); \
-        m2_event_info* tmp = new m2_event_info(name(M2_EVENT_BEGIN));\
-        if (get_connected_obj()) ((typeof(this))get_connected_obj())->name(__arg1, __arg2, __arg3); \
-        tmp->copy_info_to_event(name(M2_EVENT_END));\
-        manager.propose_events(name(M2_EVENT_END)); \
-    }; \
-    \
-    virtual m2_event& name(M2_Event_Types _type, char* event_name = NULL, sc_process_handle thread = \
-            sc_get_current_process_handle()) { \
-        thread_event_map_t* temap; \
-        if (__m2_func_event_map.find(#name) == __m2_func_event_map.end()) { \
-            temap = new thread_event_map_t; \
-            __m2_func_event_map[#name] = temap; \
-        } else { \
-            temap = __m2_func_event_map[#name]; \
-        } \
-        event_pair_t * ep; \
-        if (temap->find(thread) == temap->end()) { \
-	    char* event_beg_name; \
-	    char* event_end_name; \
-	    if (event_name != NULL) { \
-		    STR_CAT(event_beg_name, event_name, "_b"); \
-		    STR_CAT(event_end_name, event_name, "_e"); \
-            } \
-	    else { \
-		    STR_CAT(event_beg_name, #name, "_b"); \
-		    STR_CAT(event_end_name, #name, "_e"); \
-            } \
-            ep = new event_pair_t(new m2_event(event_beg_name), \
-                    new m2_event(event_end_name));\
-            (*temap)[thread] = ep; \
-        } else { \
-            ep = (*temap)[thread]; \
-        } \
-        return (_type == M2_EVENT_BEGIN)? \
-        *(ep->first) : *(ep->second); \
-    };
+    M2_PROCEDURE_EVENT(name, argument_type1, argument_type2, argument_type3)
 
 #define M2_FOURARG_PROCEDURE(name, argument_type1, argument_type2, argument_type3, argument_type4) \
-    virtual void name(argument_type1 __arg1, argument_type2 __arg2, argument_type3 __arg3, argument_type4 __arg4) { \
-        manager.propose_events(name(M2_EVENT_BEGIN)); \
-        if (get_connected_obj()) ((typeof this)get_connected_obj())->name(__arg1, __arg2, __arg3, __arg4); \
-        manager.propose_events(name(M2_EVENT_END)); \
-    }; \
-    \
-    virtual m2_event& name(M2_Event_Types _type, char* event_name = NULL, sc_process_handle thread = \
-            sc_get_current_process_handle()) { \
-        thread_event_map_t* temap; \
-        if (__m2_func_event_map.find(#name) == __m2_func_event_map.end()) { \
-            temap = new thread_event_map_t; \
-            __m2_func_event_map[#name] = temap; \
-        } else { \
-            temap = __m2_func_event_map[#name]; \
-        } \
-        event_pair_t * ep; \
-        if (temap->find(thread) == temap->end()) { \
-	    char* event_beg_name; \
-	    char* event_end_name; \
-	    if (event_name != NULL) { \
-		    STR_CAT(event_beg_name, event_name, "_b"); \
-		    STR_CAT(event_end_name, event_name, "_e"); \
-            } \
-	    else { \
-		    STR_CAT(event_beg_name, #name, "_b"); \
-		    STR_CAT(event_end_name, #name, "_e"); \
-            } \
-            ep = new event_pair_t(new m2_event(event_beg_name), \
-                    new m2_event(event_end_name));\
-            (*temap)[thread] = ep; \
-        } else { \
-            ep = (*temap)[thread]; \
-        } \
-        return (_type == M2_EVENT_BEGIN)? \
-        *(ep->first) : *(ep->second); \
-    };
+    M2_PROCEDURE(name, argument_type1, argument_type2, argument_type3, argument_type4)
 
     extern m2_manager manager;
     extern void scan_hierarchy(std::vector<m2_component *> *, sc_object * );
@@ -680,6 +536,63 @@ namespace m2_core { //begin namespace m2_core
     extern void register_scheduler(m2_scheduler* _scheduler);
     extern void m2_end(sc_process_handle proc);
 
+    //******************************************************************************
+    // Call of a wrapped interface method between its begin and end events
+    //******************************************************************************
+    template <typename return_type>
+        struct m2_invoke
+    {
+        static return_type unconnected()
+        {
+            return return_type();
+        }
+
+        template <typename Forward>
+            static return_type call(event_pair_t* ep, Forward forward)
+        {
+            manager.propose_events(*ep->first);
+            return_type ret = forward();
+            manager.propose_events(*ep->second);
+            return ret;
+        }
+
+        template <typename Forward>
+            static return_type call_passing_info(event_pair_t* ep, Forward forward)
+        {
+            manager.propose_events(*ep->first);
+            m2_event_info info(*ep->first);
+            return_type ret = forward();
+            info.copy_info_to_event(*ep->second);
+            manager.propose_events(*ep->second);
+            return ret;
+        }
+    };
+
+    template <>
+        struct m2_invoke<void>
+    {
+        static void unconnected()
+        {
+        }
+
+        template <typename Forward>
+            static void call(event_pair_t* ep, Forward forward)
+        {
+            manager.propose_events(*ep->first);
+            forward();
+            manager.propose_events(*ep->second);
+        }
+
+        template <typename Forward>
+            static void call_passing_info(event_pair_t* ep, Forward forward)
+        {
+            manager.propose_events(*ep->first);
+            m2_event_info info(*ep->first);
+            forward();
+            info.copy_info_to_event(*ep->second);
+            manager.propose_events(*ep->second);
+        }
+    };
 
 
 } //end namespace m2_core 
@@ -0,0 +1,123 @@
+// Fixed pool of worker threads used to run independent work of the manager
+// phases in parallel
+
+#ifndef M2_PARALLEL_H
+#define M2_PARALLEL_H
+
+#include "m2_base.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace m2_core { // begin namespace m2_core
+
+    //******************************************************************************
+    // Worker thread pool
+    //******************************************************************************
+    // run() executes a job on every worker and on the calling thread, and
+    // returns when all of them have finished it. The workers sleep between
+    // jobs. The jobs must not call the SystemC kernel (wait, notify, ...),
+    // which only runs on the simulation thread.
+    class m2_thread_pool
+    {
+      private:
+        std::vector<std::thread> _workers;
+        std::mutex _mutex;
+        std::condition_variable _start;
+        std::condition_variable _finish;
+        std::function<void()> _job;
+        unsigned long _generation;  // incremented for every job
+        int _running;               // workers still in the current job
+        bool _stop;
+
+        // seen: generation of the last job before the worker was created
+        void work(unsigned long seen)
+        {
+            while (true)
+            {
+                std::function<void()> job;
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    while (!_stop && (_generation == seen))
+                        _start.wait(lock);
+                    if (_stop)
+                        return;
+                    seen = _generation;
+                    job = _job;
+                }
+                job();
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    if (--_running == 0)
+                        _finish.notify_one();
+                }
+            }
+        }
+
+      public:
+        // threads is the total number of threads running a job, including
+        // the calling one
+        m2_thread_pool(int threads = 1)
+        {
+            _generation = 0;
+            _running = 0;
+            _stop = false;
+            resize(threads);
+        }
+
+        ~m2_thread_pool()
+        {
+            resize(1);
+        }
+
+        int size()
+        {
+            return _workers.size() + 1;
+        }
+
+        void resize(int threads)
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stop = true;
+            }
+            _start.notify_all();
+            for (unsigned i = 0; i < _workers.size(); i++)
+            {
+                _workers[i].join();
+            }
+            _workers.clear();
+            _stop = false;
+
+            for (int i = 1; i < threads; i++)
+            {
+                _workers.push_back(std::thread(&m2_thread_pool::work, this, _generation));
+            }
+        }
+
+        void run(const std::function<void()>& job)
+        {
+            if (_workers.empty())
+            {
+                job();
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _job = job;
+                _running = _workers.size();
+                _generation++;
+            }
+            _start.notify_all();
+            job();
+
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (_running > 0)
+                _finish.wait(lock);
+        }
+    };
+
+} // end namespace m2_core
+
+#endif
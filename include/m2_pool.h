@@ -0,0 +1,249 @@
+// Slab allocators for the core objects (events, event pairs, event infos)
+// and the arena holding the event names
+
+#ifndef M2_POOL_H
+#define M2_POOL_H
+
+#include "m2_base.h"
+#include <set>
+#include <string>
+
+namespace m2_core { // begin namespace m2_core
+
+    //******************************************************************************
+    // Common part of the pools: statistics and the registry used by the report
+    //******************************************************************************
+    class m2_pool_base
+    {
+      protected:
+        const char* _name;
+        long _live;     // objects (or bytes for the arena) currently allocated
+        long _peak;
+        long _slabs;
+
+        static std::vector<m2_pool_base *>& registry()
+        {
+            static std::vector<m2_pool_base *> pools;
+            return pools;
+        }
+
+        static bool& report_enabled()
+        {
+            static bool enabled = false;
+            return enabled;
+        }
+
+        void count_allocation(long n)
+        {
+            _live += n;
+            if (_live > _peak)
+            {
+                _peak = _live;
+            }
+        }
+
+      public:
+        m2_pool_base(const char* name)
+        {
+            _name = name;
+            _live = 0;
+            _peak = 0;
+            _slabs = 0;
+            registry().push_back(this);
+        }
+
+        virtual ~m2_pool_base()
+        {
+            std::vector<m2_pool_base *>& pools = registry();
+            pools.erase(std::remove(pools.begin(), pools.end(), this), pools.end());
+        }
+
+        const char* name()
+        {
+            return _name;
+        }
+
+        long live()
+        {
+            return _live;
+        }
+
+        long peak()
+        {
+            return _peak;
+        }
+
+        // the report is printed by m2_start when the simulation stops
+        static void set_report(bool enabled)
+        {
+            report_enabled() = enabled;
+        }
+
+        static bool get_report()
+        {
+            return report_enabled();
+        }
+
+        static void report(std::ostream& out)
+        {
+            std::vector<m2_pool_base *>& pools = registry();
+            out << "MetroII pools (live / peak / slabs):" << std::endl;
+            for (unsigned i = 0; i < pools.size(); i++)
+            {
+                out << "  " << pools[i]->_name << ": " << pools[i]->_live << " / "
+                    << pools[i]->_peak << " / " << pools[i]->_slabs << std::endl;
+            }
+        }
+    };
+
+    //******************************************************************************
+    // Fixed size object pool
+    //******************************************************************************
+    // Objects are carved out of slabs of SLAB_SIZE slots, freed slots go to a
+    // free list and are reused first. Slabs are only given back when the pool is
+    // destroyed with no live object.
+    template <typename T, int SLAB_SIZE = 256>
+        class m2_pool : public m2_pool_base
+    {
+      private:
+        union slot
+        {
+            slot* next;
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+        };
+
+        std::vector<slot *> _slab_list;
+        slot* _free;
+
+        void add_slab()
+        {
+            slot* slab = static_cast<slot *>(::operator new(SLAB_SIZE * sizeof(slot)));
+            for (int i = 0; i < SLAB_SIZE - 1; i++)
+            {
+                slab[i].next = &slab[i + 1];
+            }
+            slab[SLAB_SIZE - 1].next = _free;
+            _free = slab;
+            _slab_list.push_back(slab);
+            _slabs++;
+        }
+
+      public:
+        m2_pool(const char* name) : m2_pool_base(name)
+        {
+            _free = NULL;
+        }
+
+        ~m2_pool()
+        {
+            if (_live == 0)
+            {
+                for (unsigned i = 0; i < _slab_list.size(); i++)
+                {
+                    ::operator delete(_slab_list[i]);
+                }
+            }
+        }
+
+        // raw storage for one T
+        void* allocate()
+        {
+            if (_free == NULL)
+            {
+                add_slab();
+            }
+            slot* s = _free;
+            _free = s->next;
+            count_allocation(1);
+            return s;
+        }
+
+        void release(void* p)
+        {
+            slot* s = static_cast<slot *>(p);
+            s->next = _free;
+            _free = s;
+            _live--;
+        }
+
+        template <typename... Args>
+            T* create(Args&&... args)
+        {
+            return new (allocate()) T(std::forward<Args>(args)...);
+        }
+
+        void destroy(T* p)
+        {
+            p->~T();
+            release(p);
+        }
+    };
+
+    //******************************************************************************
+    // Arena of interned strings
+    //******************************************************************************
+    // Event names are built once per event and never change, so they are copied
+    // into large chunks and shared between all events with the same name. The
+    // strings live as long as the arena.
+    class m2_string_arena : public m2_pool_base
+    {
+      private:
+        static const int CHUNK_SIZE = 4096;
+
+        std::vector<char *> _chunks;
+        int _used;      // bytes used in the last chunk
+        std::set<const char *, ltstr> _strings;
+        std::string _buffer;
+
+        char* allocate(int size)
+        {
+            if (_chunks.empty() || (_used + size > CHUNK_SIZE))
+            {
+                _chunks.push_back(new char[std::max(size, (int)CHUNK_SIZE)]);
+                _used = 0;
+                _slabs++;
+            }
+            char* p = _chunks.back() + _used;
+            _used += size;
+            count_allocation(size);
+            return p;
+        }
+
+      public:
+        m2_string_arena(const char* name) : m2_pool_base(name)
+        {
+            _used = 0;
+        }
+
+        ~m2_string_arena()
+        {
+            for (unsigned i = 0; i < _chunks.size(); i++)
+            {
+                delete [] _chunks[i];
+            }
+        }
+
+        // returns the shared copy of the concatenation of s1 and s2
+        const char* intern(const char* s1, const char* s2 = "")
+        {
+            _buffer.assign(s1);
+            _buffer.append(s2);
+
+            std::set<const char *, ltstr>::iterator it = _strings.find(_buffer.c_str());
+            if (it != _strings.end())
+            {
+                return *it;
+            }
+
+            char* s = allocate(_buffer.size() + 1);
+            memcpy(s, _buffer.c_str(), _buffer.size() + 1);
+            _strings.insert(s);
+            return s;
+        }
+    };
+
+    extern m2_string_arena name_arena;
+
+} // end namespace m2_core
+
+#endif
@@ -0,0 +1,179 @@
+// Counter-based random number streams (Philox4x32-10) for stochastic
+// adaptors and annotators
+
+#ifndef M2_RANDOM_H
+#define M2_RANDOM_H
+
+#include <stdint.h>
+#include <cstring>
+
+namespace m2_core { // begin namespace m2_core
+
+    // seed of the streams that are not given one, set in sc_main or with the
+    // M2_SEED environment variable (read by m2_start)
+    extern uint64_t m2_random_seed;
+
+    //******************************************************************************
+    // Random stream
+    //******************************************************************************
+    // The n-th number of a stream is a function of (seed, component, event, n)
+    // only: the Philox4x32-10 block cipher, keyed by the seed, applied to the
+    // counter (n / 4, component, event). There is no state shared between
+    // streams, so the numbers drawn do not depend on the number of threads
+    // or on the order in which the streams are used, and a stream can be
+    // moved to any position with seek().
+    //
+    // component and event are usually key_of() of the names, which do not
+    // change between runs like the event IDs may.
+    class m2_random_stream
+    {
+      private:
+        uint32_t _key[2];       // seed
+        uint32_t _stream[2];    // component, event
+        uint64_t _position;     // of the next number
+        uint64_t _cached;       // block in _block, ~0 if none
+        uint32_t _block[4];
+
+        static inline void round(uint32_t c[4], const uint32_t k[2])
+        {
+            uint64_t p0 = (uint64_t)0xD2511F53 * c[0];
+            uint64_t p1 = (uint64_t)0xCD9E8D57 * c[2];
+            uint32_t c1 = c[1];
+            c[0] = (uint32_t)(p1 >> 32) ^ c1 ^ k[0];
+            c[1] = (uint32_t)p1;
+            c[2] = (uint32_t)(p0 >> 32) ^ c[3] ^ k[1];
+            c[3] = (uint32_t)p0;
+        }
+
+        void compute(uint64_t block, uint32_t out[4])
+        {
+            uint32_t counter[4] = {(uint32_t)block, (uint32_t)(block >> 32), _stream[0], _stream[1]};
+            philox(counter, _key, out);
+        }
+
+      public:
+        m2_random_stream()
+        {
+            set_key(m2_random_seed, 0, 0);
+        }
+
+        m2_random_stream(uint64_t seed, uint32_t component, uint32_t event = 0)
+        {
+            set_key(seed, component, event);
+        }
+
+        // restarts the stream at position 0
+        void set_key(uint64_t seed, uint32_t component, uint32_t event = 0)
+        {
+            _key[0] = (uint32_t)seed;
+            _key[1] = (uint32_t)(seed >> 32);
+            _stream[0] = component;
+            _stream[1] = event;
+            _position = 0;
+            _cached = ~(uint64_t)0;
+        }
+
+        uint64_t tell()
+        {
+            return _position;
+        }
+
+        void seek(uint64_t position)
+        {
+            _position = position;
+        }
+
+        uint32_t next()
+        {
+            uint64_t block = _position >> 2;
+            if (block != _cached)
+            {
+                compute(block, _block);
+                _cached = block;
+            }
+            return _block[_position++ & 3];
+        }
+
+        // the next n numbers, whole blocks are written directly to out
+        void generate(uint32_t* out, int n)
+        {
+            int i = 0;
+            while ((i < n) && ((_position & 3) != 0))
+                out[i++] = next();
+            for (; i + 4 <= n; i += 4)
+            {
+                compute(_position >> 2, out + i);
+                _position += 4;
+            }
+            while (i < n)
+                out[i++] = next();
+        }
+
+        // n integers in [low, high], one number each, mapped by multiplication
+        // (the bias is at most (high - low + 1) / 2^32)
+        void uniform_int(int* out, int n, int low, int high)
+        {
+            uint64_t range = (uint64_t)((int64_t)high - low + 1);
+            generate((uint32_t *)out, n);
+            for (int i = 0; i < n; i++)
+            {
+                out[i] = low + (int)(((uint64_t)(uint32_t)out[i] * range) >> 32);
+            }
+        }
+
+        int uniform_int(int low, int high)
+        {
+            int x;
+            uniform_int(&x, 1, low, high);
+            return x;
+        }
+
+        // n doubles in [0, 1) with 53 random bits, two numbers each
+        void uniform(double* out, int n)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                uint64_t x = ((uint64_t)next() << 32) | next();
+                out[i] = (x >> 11) * (1.0 / 9007199254740992.0);
+            }
+        }
+
+        double uniform()
+        {
+            double x;
+            uniform(&x, 1);
+            return x;
+        }
+
+        // Philox4x32 with 10 rounds
+        static void philox(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4])
+        {
+            uint32_t c[4] = {counter[0], counter[1], counter[2], counter[3]};
+            uint32_t k[2] = {key[0], key[1]};
+            for (int r = 0; r < 10; r++)
+            {
+                if (r > 0)
+                {
+                    k[0] += 0x9E3779B9;
+                    k[1] += 0xBB67AE85;
+                }
+                round(c, k);
+            }
+            memcpy(out, c, sizeof(c));
+        }
+
+        // FNV-1a hash of a name, to key streams by component or event name
+        static uint32_t key_of(const char* name)
+        {
+            uint32_t h = 2166136261u;
+            for (; *name != 0; name++)
+            {
+                h = (h ^ (unsigned char)*name) * 16777619u;
+            }
+            return h;
+        }
+    };
+
+} // end namespace m2_core
+
+#endif
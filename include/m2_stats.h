@@ -0,0 +1,164 @@
+// Per-phase timing and counters of the manager loop
+
+#ifndef M2_STATS_H
+#define M2_STATS_H
+
+#include "m2_base.h"
+#include <chrono>
+#include <iomanip>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define M2_TIMESTAMP_UNIT "cycles"
+#else
+#define M2_TIMESTAMP_UNIT "ns"
+#endif
+
+namespace m2_core { // begin namespace m2_core
+
+    // time stamp counter where available, nanoseconds of a monotonic clock otherwise
+    inline unsigned long long m2_timestamp()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    enum M2_Phase
+    {
+        M2_PHASE_BASE_MODEL,    // phase 1, includes the SystemC kernel
+        M2_PHASE_ANNOTATION,    // phase 2
+        M2_PHASE_SOLVING,       // phase 3.1
+        M2_PHASE_SCHEDULING,    // phase 3.2
+        M2_PHASE_POST,          // post_schedule and post_resolve
+        M2_PHASE_ENABLE,        // phase 3.3
+        M2_NUM_PHASES
+    };
+
+    //******************************************************************************
+    // Statistics of the manager phases
+    //******************************************************************************
+    // Disabled by default. When enabled, every phase boundary reads the time
+    // stamp once, and the per-iteration counters are plain additions.
+    class m2_phase_stats
+    {
+      private:
+        bool _enabled;
+        unsigned long long _ticks[M2_NUM_PHASES];
+        unsigned long long _last;   // time stamp of the last phase boundary
+        long _iterations;
+        long _rounds;               // fixpoint rounds of phase 3
+        long _max_rounds;
+        long _enabled_events;
+        long _max_enabled_events;
+        std::chrono::steady_clock::time_point _start;
+
+      public:
+        m2_phase_stats()
+        {
+            _enabled = false;
+            reset();
+        }
+
+        void reset()
+        {
+            for (int i = 0; i < M2_NUM_PHASES; i++)
+            {
+                _ticks[i] = 0;
+            }
+            _iterations = 0;
+            _rounds = 0;
+            _max_rounds = 0;
+            _enabled_events = 0;
+            _max_enabled_events = 0;
+            _start = std::chrono::steady_clock::now();
+            _last = m2_timestamp();
+        }
+
+        void set_enabled(bool enabled)
+        {
+            if (enabled && !_enabled)
+            {
+                reset();
+            }
+            _enabled = enabled;
+        }
+
+        bool enabled()
+        {
+            return _enabled;
+        }
+
+        // charge the time since the last boundary to phase
+        void end_phase(M2_Phase phase)
+        {
+            unsigned long long now = m2_timestamp();
+            _ticks[phase] += now - _last;
+            _last = now;
+        }
+
+        void end_iteration(long rounds, long enabled_events)
+        {
+            _iterations++;
+            _rounds += rounds;
+            _max_rounds = std::max(_max_rounds, rounds);
+            _enabled_events += enabled_events;
+            _max_enabled_events = std::max(_max_enabled_events, enabled_events);
+        }
+
+        long iterations()
+        {
+            return _iterations;
+        }
+
+        long events_enabled()
+        {
+            return _enabled_events;
+        }
+
+        // wall clock time since the statistics were enabled
+        double seconds()
+        {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+        }
+
+        void report(std::ostream& out)
+        {
+            static const char* phase_names[M2_NUM_PHASES] = {
+                "base_model", "annotation", "solving", "scheduling", "post", "enable"
+            };
+
+            double seconds = this->seconds();
+            unsigned long long total = 0;
+            for (int i = 0; i < M2_NUM_PHASES; i++)
+            {
+                total += _ticks[i];
+            }
+            double iterations = (_iterations > 0) ? _iterations : 1;
+
+            out << "MetroII manager statistics:" << std::endl;
+            out << "  iterations: " << _iterations << std::endl;
+            out << "  wall_seconds: " << seconds << std::endl;
+            out << "  iterations_per_second: " << ((seconds > 0) ? _iterations / seconds : 0) << std::endl;
+            out << "  fixpoint_rounds: " << _rounds << " (avg " << _rounds / iterations
+                << ", max " << _max_rounds << ")" << std::endl;
+            out << "  events_enabled: " << _enabled_events << " (avg " << _enabled_events / iterations
+                << ", max " << _max_enabled_events << ")" << std::endl;
+            out << "  phase_" M2_TIMESTAMP_UNIT ":" << std::endl;
+            for (int i = 0; i < M2_NUM_PHASES; i++)
+            {
+                out << "    " << std::left << std::setw(12) << phase_names[i] << std::right
+                    << std::setw(16) << _ticks[i] << "  " << std::fixed << std::setprecision(1)
+                    << ((total > 0) ? 100.0 * _ticks[i] / total : 0.0) << "%" << std::endl;
+                out.unsetf(std::ios::fixed);
+                out << std::setprecision(6);
+            }
+        }
+    };
+
+} // end namespace m2_core
+
+#endif
@@ -12,12 +12,21 @@
 
 #include "m2_base.h"
 #include "m2_debug.h"
+#include "m2_log.h"
+#include "m2_random.h"
+#include "m2_event_table.h"
+#include "m2_pool.h"
 #include "m2_event.h"
 #include "m2_component.h"
 #include "m2_interface.h"
 #include "m2_ports.h"
 #include "m2_constraints.h"
+#include "m2_parallel.h"
+#include "m2_cost_table.h"
 #include "m2_ann_sched.h"
+#include "m2_cost.h"
+#include "m2_cluster.h"
+#include "m2_stats.h"
 #include "m2_manager.h"
 #include "m2_adaptor.h"
 
@@ -63,6 +63,13 @@ CXX_OPTIMIZER = -O2 -g
 # CXX_WARNINGS  - Flags that print warnings.
 CXX_WARNINGS = -Wno-deprecated -Wall
 
+# the method wrappers of m2_manager.h use lambdas and std::forward
+CXX_STANDARD = -std=gnu++11
+
+# the manager can run annotators on worker threads (m2_parallel.h)
+CXX_THREADS = -pthread
+THREAD_LIBS = -lpthread
+
 # CXX_MAKEFILE_FLAGS - Metropolis makefiles may optionally set this for
 #   flags that are included on a per makefile basis.
 #
@@ -73,7 +80,7 @@ CXX_WARNINGS = -Wno-deprecated -Wall
 
 CXX_INCLUDE_FLAGS = -I$(SYSTEMC)/include -I$(ROOT)/include
 
-CXX_FLAGS = $(CXX_OPTIMIZER) $(CXX_WARNINGS) $(CXX_INCLUDE_FLAGS) $(CXX_MAKEFILE_FLAGS) $(CXX_COVERAGE_FLAGS) $(CXX_USERFLAGS)
+CXX_FLAGS = $(CXX_OPTIMIZER) $(CXX_STANDARD) $(CXX_THREADS) $(CXX_WARNINGS) $(CXX_INCLUDE_FLAGS) $(CXX_MAKEFILE_FLAGS) $(CXX_COVERAGE_FLAGS) $(CXX_USERFLAGS)
 
 # Set to h.264-decoder and used in example/makefile if SDL is found.
 METROII_H264_DIR = 
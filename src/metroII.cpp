@@ -34,8 +34,85 @@
 namespace m2_core { // begin namespace m2_core 
 
 
+    m2_string_arena name_arena("event names (bytes)"); // interned event names
+    m2_pool<m2_event> event_pool("m2_event");
+    m2_pool<m2_event_info> event_info_pool("m2_event_info");
+    m2_pool<event_pair_t> event_pair_pool("event_pair_t");
+
+    m2_event_table event_table; // IDs and symbol table of all events
+
+    m2_logger m2_log; // trace records of all subsystems
+    uint64_t m2_random_seed = 0; // seed of the random streams, M2_SEED overrides it
+
+    std::vector<m2_event *> m2_event::_dirty_events; // events changed in the current iteration
+
+    std::atomic<unsigned long> m2_event::_epoch(0); // status changes of all events
+    thread_local m2_deferred_changes* m2_event::_deferred = NULL; // set by phase 3 cluster threads
+
+    m2_process_table process_table; // dense indices of the processes calling interface methods
+
     m2_manager manager("Manager"); // instantiate the manager
 
+    //******************************************************************************
+    // event symbol table
+    //******************************************************************************
+    struct ltsymbol
+    {
+        bool operator()(const std::pair<const char*, int>& s1, const std::pair<const char*, int>& s2) const
+        {
+            return strcmp(s1.first, s2.first) < 0;
+        }
+    };
+
+    void m2_event_table::build_symbol_table()
+    {
+        _symbols.clear();
+        for (unsigned i = 0; i < _events.size(); i++)
+        {
+            if (_events[i] != NULL)
+            {
+                _symbols.push_back(std::make_pair(_events[i]->get_full_name(), (int)i));
+            }
+        }
+        // stable, so that the lowest ID wins if two events share a name
+        std::stable_sort(_symbols.begin(), _symbols.end(), ltsymbol());
+        _symbols_valid = true;
+    }
+
+    int m2_event_table::lookup(const char* full_name)
+    {
+        if (!_symbols_valid)
+        {
+            build_symbol_table();
+        }
+
+        std::pair<const char*, int> key(full_name, -1);
+        std::vector<std::pair<const char*, int> >::iterator it;
+        it = std::lower_bound(_symbols.begin(), _symbols.end(), key, ltsymbol());
+        if ((it == _symbols.end()) || (strcmp(it->first, full_name) != 0))
+        {
+            return -1;
+        }
+        return it->second;
+    }
+
+    //******************************************************************************
+    // event destruction
+    //******************************************************************************
+
+    m2_event::~m2_event()
+    {
+        if (_dirty_index >= 0)
+        {
+            _dirty_events[_dirty_index] = NULL;
+        }
+        if (is_pending())
+        {
+            manager.remove_pending_event(this);
+        }
+        event_table.unregister_event(_id);
+    }
+
     //******************************************************************************
     // set up the manager and start the simulation
     //******************************************************************************
@@ -43,7 +120,7 @@ namespace m2_core { // begin namespace m2_core
     {
         std::vector<sc_object*> children = obj->get_child_objects();
 
-        std::cout << obj->name() << " " << obj->kind() << std::endl ; // Print the name and kind
+        M2_LOG(M2_LOG_CORE, M2_LOG_INFO, "%s %s", obj->name(), obj->kind()); // Print the name and kind
         if ( strcmp(obj->kind(),"sc_thread_process") == 0 )
         {
             (*total)++;
@@ -64,6 +141,13 @@ namespace m2_core { // begin namespace m2_core
 
     void m2_start() 
     {
+        // run time log levels, e.g. M2_LOG=sched=0,manager=2
+        m2_log.configure(getenv("M2_LOG"));
+
+        // seed of the random streams, e.g. M2_SEED=42
+        if (getenv("M2_SEED") != NULL)
+            m2_random_seed = strtoull(getenv("M2_SEED"), NULL, 0);
+
         // gather all components in the design
         int total_num_processes = 0;
 
@@ -78,9 +162,27 @@ namespace m2_core { // begin namespace m2_core
         }
 
         manager.set_number_of_processes_in_system(total_num_processes);
-        cout << "Total processes = " << total_num_processes << endl;
+        M2_LOG(M2_LOG_CORE, M2_LOG_INFO, "Total processes = %d", total_num_processes);
+        m2_log.flush_if_idle();
+
+        event_table.build_symbol_table();
+        manager.elaborate();
 
         sc_start();
+
+        m2_log.flush();
+
+        if (manager.get_stats().enabled())
+        {
+            manager.get_stats().report(cout);
+        }
+
+        if (m2_pool_base::get_report())
+        {
+            m2_pool_base::report(cout);
+        }
+
+        m2_interface::release_all();
     }
 
     void m2_wait( const sc_event & m, sc_simcontext * s)
@@ -142,6 +244,7 @@ namespace m2_core { // begin namespace m2_core
             if (manager.scheduler_list[i]->type >= 1)
             {
                 manager.scheduler_list[i]->update_end_process(proc);
+                manager.scheduler_list[i]->touch();
             }
         }
         manager.decrement_total_procs();
@@ -0,0 +1,93 @@
+/*
+   Copyright (c) 2007 The Regents of the University of California.
+   All rights reserved.
+
+   Permission is hereby granted, without written agreement and without
+   license or royalty fees, to use, copy, modify, and distribute this
+   software and its documentation for any purpose, provided that the
+   above copyright notice and the following two paragraphs appear in all
+   copies of this software and that appropriate acknowledgments are made
+   to the research of the Metropolis group.
+
+   IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO ANY PARTY
+   FOR DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES
+   ARISING OUT OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF
+   THE UNIVERSITY OF CALIFORNIA HAS BEEN ADVISED OF THE POSSIBILITY OF
+   SUCH DAMAGE.
+
+   THE UNIVERSITY OF CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE SOFTWARE
+   PROVIDED HEREUNDER IS ON AN "AS IS" BASIS, AND THE UNIVERSITY OF
+   CALIFORNIA HAS NO OBLIGATION TO PROVIDE MAINTENANCE, SUPPORT, UPDATES,
+   ENHANCEMENTS, OR MODIFICATIONS.
+
+   METROPOLIS_COPYRIGHT_VERSION_1
+   COPYRIGHTENDKEY
+   */
+
+// Converts a CSV cost table into the binary cost table read by
+// m2_physical_time_annotator::set_cost_table.
+//
+// usage: m2_cost_convert input.csv output.m2cost
+//
+// Each line of the input is "full event name,cost"; empty lines and lines
+// starting with # are skipped. The full name of an event is the name of its
+// owner followed by the event name, as in the time table.
+
+#include "m2_cost_table.h"
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+
+using namespace std;
+using namespace m2_core;
+
+int main(int argc, char** argv)
+{
+    if (argc != 3)
+    {
+        cerr << "usage: " << argv[0] << " input.csv output.m2cost" << endl;
+        return 1;
+    }
+
+    ifstream in(argv[1]);
+    if (!in)
+    {
+        cerr << "cannot read " << argv[1] << endl;
+        return 1;
+    }
+
+    vector<pair<string, double> > entries;
+    string line;
+    int line_number = 0;
+    while (getline(in, line))
+    {
+        line_number++;
+        if (!line.empty() && (line[line.size() - 1] == '\r'))
+            line.erase(line.size() - 1);
+        if (line.empty() || (line[0] == '#'))
+            continue;
+
+        // the name may contain commas, the cost follows the last one
+        size_t comma = line.rfind(',');
+        char* end = NULL;
+        double cost = 0;
+        if (comma != string::npos)
+            cost = strtod(line.c_str() + comma + 1, &end);
+        if ((comma == string::npos) || (comma == 0) || (end == line.c_str() + comma + 1))
+        {
+            cerr << argv[1] << ":" << line_number << ": expected name,cost" << endl;
+            return 1;
+        }
+        entries.push_back(make_pair(line.substr(0, comma), cost));
+    }
+
+    if (!m2_cost_table::write(argv[2], entries))
+    {
+        cerr << "cannot write " << argv[2] << endl;
+        return 1;
+    }
+    cout << entries.size() << " entries read, table written to " << argv[2] << endl;
+    return 0;
+}